@@ -0,0 +1,61 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_AWSCHUNKEDDEVICE_HXX
+#define EXVHP_AWSCHUNKEDDEVICE_HXX
+
+#include "AwsSigV4.hxx"
+#include "ReadOnlyDevice.hxx"
+
+namespace eXVHP::Service {
+// Source encoded as an S3 aws-chunked payload, signed chunk by chunk as read
+class AwsChunkedDevice : public ReadOnlyDevice {
+private:
+  QByteArray m_chunk;
+  qint64 m_chunkOffset;
+  qint64 m_chunkSize;
+  qint64 m_decodedRead;
+  qint64 m_decodedSize;
+  bool m_finalChunkRead;
+  QByteArray m_previousSignature;
+  QDateTime m_reqTime;
+  QByteArray m_seedSignature;
+  AwsSigV4 m_signer;
+  QByteArray m_signingKey;
+  QIODevice *m_source;
+  bool nextChunk();
+
+protected:
+  qint64 readData(char *data, qint64 maxSize) override;
+
+public:
+  static qint64 defaultChunkSize;
+
+  AwsChunkedDevice(QIODevice *source, qint64 decodedSize,
+                   const AwsSigV4 &signer, const QDateTime &reqTime,
+                   const QByteArray &seedSignature,
+                   qint64 chunkSize = defaultChunkSize,
+                   QObject *parent = nullptr);
+  static qint64 encodedSize(qint64 decodedSize,
+                            qint64 chunkSize = defaultChunkSize);
+  bool isSequential() const override;
+  bool seek(qint64 pos) override;
+  qint64 size() const override;
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_AWSCHUNKEDDEVICE_HXX
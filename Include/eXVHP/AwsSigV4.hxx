@@ -0,0 +1,80 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_AWSSIGV4_HXX
+#define EXVHP_AWSSIGV4_HXX
+
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QNetworkRequest>
+
+namespace eXVHP::Service {
+// AWS Signature Version 4 for one set of credentials. Derived signing keys
+// are shared between all signers through a small cache keyed by access key,
+// date, region and service, so the four-step HMAC chain runs once per day
+// instead of once per request.
+class AwsSigV4 {
+private:
+  QString m_accessKeyId;
+  QString m_region;
+  QString m_secretAccessKey;
+  QString m_service;
+  static QHash<QByteArray, QByteArray> keyCache;
+  static QMutex keyCacheMutex;
+  static QByteArray canonicalQuery(const QUrl &url);
+  static QByteArray hmacSha256(const QByteArray &key, const QByteArray &data);
+  QByteArray signature(const QByteArray &canonicalRequest,
+                       const QByteArray &amzDate, const QByteArray &reqScope,
+                       const QDate &date) const;
+
+public:
+  static QByteArray emptyPayloadHash;
+  static int keyCacheSize;
+  static QByteArray streamingPayload;
+  static QByteArray unsignedPayload;
+
+  AwsSigV4(const QString &accessKeyId, const QString &secretAccessKey,
+           const QString &region, const QString &service = "s3");
+  static void clearKeyCache();
+  QString scope(const QDate &date) const;
+  QByteArray signingKey(const QDate &date) const;
+
+  // Adds x-amz-date, x-amz-content-sha256 (S3 only) and Authorization
+  // headers to the request and returns the hex encoded signature (the seed
+  // signature for aws-chunked payloads). Other services sign payloadHash
+  // without sending it.
+  QByteArray
+  sign(QNetworkRequest &request, const QByteArray &method,
+       const QByteArray &payloadHash,
+       const QDateTime &reqTime = QDateTime::currentDateTimeUtc()) const;
+
+  // URL carrying the signature in its query, valid for expires seconds and
+  // usable without any extra headers. Only the host header is signed and
+  // the payload is left unsigned.
+  QUrl
+  presign(const QUrl &url, const QByteArray &method, int expires,
+          const QString &sessionToken = QString(),
+          const QDateTime &reqTime = QDateTime::currentDateTimeUtc()) const;
+  QByteArray chunkSignature(const QByteArray &signingKey,
+                            const QDateTime &reqTime,
+                            const QByteArray &previousSignature,
+                            const QByteArray &chunkHash) const;
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_AWSSIGV4_HXX
@@ -0,0 +1,47 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_DUBZLINKIDSCANNER_HXX
+#define EXVHP_DUBZLINKIDSCANNER_HXX
+
+#include <QByteArrayMatcher>
+#include <QString>
+
+namespace eXVHP::Service {
+// Finds the value of the link_id hidden input in the Dubz home page as it
+// downloads, working on raw bytes. Only the last few bytes of a chunk are
+// carried over to the next, enough for a match split between two chunks,
+// so the page is never buffered as a whole.
+class DubzLinkIdScanner {
+private:
+  QByteArray m_carry;
+  bool m_found;
+  bool m_inValue;
+  QByteArray m_linkId;
+  static QByteArrayMatcher inputMatcher;
+  static QByteArray inputPrefix;
+  static qsizetype maxLinkIdSize;
+
+public:
+  DubzLinkIdScanner();
+  bool feed(const QByteArray &data);
+  bool isFound() const;
+  QString linkId() const;
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_DUBZLINKIDSCANNER_HXX
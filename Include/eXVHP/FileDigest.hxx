@@ -0,0 +1,65 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_FILEDIGEST_HXX
+#define EXVHP_FILEDIGEST_HXX
+
+#include "FileHashCache.hxx"
+#include "MappedFile.hxx"
+#include <QFuture>
+#include <QSharedPointer>
+#include <QString>
+#include <QThreadPool>
+#include <functional>
+
+namespace eXVHP::Service {
+class FileDigest {
+private:
+  static FileHashCache cache;
+  static qint64 readChunkSize;
+  static QByteArray cachedSha256(const QString &fileName,
+                                 std::function<QByteArray()> hash);
+  static QByteArray hashFile(const QString &fileName, qint64 offset,
+                             qint64 length);
+
+public:
+  // Digest of the file from the cache without reading it, or an empty
+  // QByteArray if it is not cached or the cache is off
+  static QByteArray cachedDigest(const QString &fileName);
+  // Whole-file digests are looked up in and added to a FileHashCache at
+  // cachePath; an empty path turns the cache off
+  static void setCachePath(const QString &cachePath,
+                           int maxEntries = FileHashCache::defaultMaxEntries);
+  // Hash the file on a worker thread so large files never block the thread
+  // owning the QNetworkAccessManager. Resolves to an empty QByteArray if the
+  // file could not be read.
+  static QFuture<QByteArray>
+  sha256(const QString &fileName,
+         QThreadPool *pool = QThreadPool::globalInstance());
+  // Hash length bytes starting at offset, or up to the end of the file if
+  // length is negative.
+  static QFuture<QByteArray>
+  sha256(const QString &fileName, qint64 offset, qint64 length,
+         QThreadPool *pool = QThreadPool::globalInstance());
+  // Hash an opened mapping, sharing its pages with the upload body
+  static QFuture<QByteArray>
+  sha256(QSharedPointer<MappedFile> mappedFile,
+         QThreadPool *pool = QThreadPool::globalInstance());
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_FILEDIGEST_HXX
@@ -0,0 +1,69 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_FILEHASHCACHE_HXX
+#define EXVHP_FILEHASHCACHE_HXX
+
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+
+namespace eXVHP::Service {
+// On-disk index of file SHA-256 digests, keyed by device, inode, size and
+// modification time in nanoseconds so any change to a file misses. The index
+// is a fixed array of records mapped into memory on first use; once it is
+// full the least recently used record is replaced. Used from the hashing
+// worker threads, so every access is serialized.
+class FileHashCache {
+private:
+  struct Header {
+    char magic[8];
+    quint32 capacity;
+    quint32 count;
+    quint64 clock;
+  };
+
+  struct Record {
+    char key[32];
+    quint64 lastUsed;
+    char digest[32];
+  };
+
+  uchar *m_data;
+  QFile m_file;
+  bool m_loaded;
+  int m_maxEntries;
+  QMutex m_mutex;
+  QHash<QByteArray, quint32> m_slots;
+  Header *header() const;
+  bool load();
+  Record *record(quint32 slot) const;
+  void unload();
+
+public:
+  static int defaultMaxEntries;
+
+  FileHashCache();
+  void close();
+  QByteArray digest(const QByteArray &fileKey);
+  static QByteArray fileKey(const QString &fileName);
+  void insert(const QByteArray &fileKey, const QByteArray &digest);
+  void open(const QString &path, int maxEntries = defaultMaxEntries);
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_FILEHASHCACHE_HXX
@@ -0,0 +1,45 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_FILERANGEDEVICE_HXX
+#define EXVHP_FILERANGEDEVICE_HXX
+
+#include "ReadOnlyDevice.hxx"
+#include <QFile>
+
+namespace eXVHP::Service {
+// length bytes of a file from offset, read through its own handle
+class FileRangeDevice : public ReadOnlyDevice {
+private:
+  QFile m_file;
+  qint64 m_length;
+  qint64 m_offset;
+
+protected:
+  bool openSource() override;
+  qint64 readData(char *data, qint64 maxSize) override;
+
+public:
+  FileRangeDevice(const QString &fileName, qint64 offset, qint64 length,
+                  QObject *parent = nullptr);
+  void close() override;
+  bool seek(qint64 pos) override;
+  qint64 size() const override;
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_FILERANGEDEVICE_HXX
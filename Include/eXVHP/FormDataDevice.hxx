@@ -0,0 +1,56 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_FORMDATADEVICE_HXX
+#define EXVHP_FORMDATADEVICE_HXX
+
+#include "ReadOnlyDevice.hxx"
+#include <QList>
+
+namespace eXVHP::Service {
+// multipart/form-data body like QHttpMultiPart, but a plain device that can
+// be wrapped. Parts are added before the first open().
+class FormDataDevice : public ReadOnlyDevice {
+private:
+  struct Segment {
+    QByteArray data;
+    QIODevice *device;
+    qint64 offset;
+    qint64 size;
+  };
+
+  QByteArray m_boundary;
+  bool m_finished;
+  QList<Segment> m_segments;
+  void append(const QByteArray &data, QIODevice *device = nullptr);
+
+protected:
+  bool openSource() override;
+  qint64 readData(char *data, qint64 maxSize) override;
+
+public:
+  FormDataDevice(QObject *parent = nullptr);
+  void addField(const QString &name, const QByteArray &value);
+  void addFile(const QString &name, const QString &fileName,
+               const QString &mimeType, QIODevice *device);
+  QByteArray contentType() const;
+  bool seek(qint64 pos) override;
+  qint64 size() const override;
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_FORMDATADEVICE_HXX
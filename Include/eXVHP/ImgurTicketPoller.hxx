@@ -0,0 +1,74 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_IMGURTICKETPOLLER_HXX
+#define EXVHP_IMGURTICKETPOLLER_HXX
+
+#include "RetryPolicy.hxx"
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QSet>
+#include <QTimer>
+
+namespace eXVHP::Service {
+// Polls Imgur for every outstanding upload ticket with one batched
+// tickets[] request. The first poll happens shortly after a ticket is added,
+// then the interval doubles up to a ceiling while tickets remain. A poll
+// that fails transiently keeps its tickets and is sent again after the retry
+// rule's backoff; only a permanent failure or one past the rule's attempts
+// fails the tickets it carried.
+class ImgurTicketPoller : public QObject {
+  Q_OBJECT
+
+private:
+  QString m_clientId;
+  int m_failedPolls;
+  bool m_http2Allowed;
+  int m_interval;
+  int m_initialInterval;
+  int m_maxInterval;
+  QNetworkAccessManager *m_nam;
+  QNetworkReply *m_pollResp;
+  QString m_pollUrl;
+  RetryPolicy::Rule m_retryRule;
+  QSet<QString> m_tickets;
+  bool m_ticketsAdded;
+  QTimer m_timer;
+  void poll();
+  void schedulePoll();
+
+public:
+  static int defaultInitialInterval;
+  static int defaultMaxInterval;
+
+  ImgurTicketPoller(QNetworkAccessManager *nam, const QString &pollUrl,
+                    const QString &clientId, QObject *parent = nullptr);
+  void addTicket(const QString &ticket);
+  void removeTicket(const QString &ticket);
+  void setHttp2Allowed(bool http2Allowed);
+  void setIntervals(int initialInterval, int maxInterval);
+  void setPollUrl(const QString &pollUrl);
+  void setRetryRule(const RetryPolicy::Rule &retryRule);
+
+signals:
+  void ticketDone(const QString &ticket, const QString &videoId,
+                  const QString &videoDeletehash);
+  void ticketFailed(const QString &ticket, const QString &error);
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_IMGURTICKETPOLLER_HXX
@@ -0,0 +1,63 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_MAPPEDFILE_HXX
+#define EXVHP_MAPPEDFILE_HXX
+
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+
+namespace eXVHP::Service {
+// Read-only memory mapping of a whole file, shared by an upload body and its
+// payload hash so the file is only paged in once. Readers can prefetch pages
+// ahead of them and release pages behind them to keep page cache churn low.
+// Released pages leave only this mapping; the file's pages leave the page
+// cache when the last mapping of the file in the process is destroyed, so
+// readers sharing the file are not made to read it from disk again.
+//
+// On Unix, touching a page past the end of a file truncated after it was
+// mapped raises SIGBUS. Readers check isReadable() before every copy, which
+// turns a truncation into a read error; one racing the copy itself can still
+// fault, so files that may be rewritten during an upload should not be
+// mapped.
+class MappedFile {
+private:
+  const uchar *m_data;
+  QFile m_file;
+  QPair<quint64, quint64> m_fileId;
+  qint64 m_releasedEnd;
+  qint64 m_size;
+  static QHash<QPair<quint64, quint64>, int> openMappings;
+  static QMutex openMappingsMutex;
+  static qint64 pageSize();
+
+public:
+  MappedFile(const QString &fileName);
+  ~MappedFile();
+  const uchar *data() const;
+  QString errorString() const;
+  QString fileName() const;
+  bool isReadable(qint64 offset, qint64 length) const;
+  bool open();
+  void prefetch(qint64 offset, qint64 length);
+  void release(qint64 offset, qint64 length);
+  qint64 size() const;
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_MAPPEDFILE_HXX
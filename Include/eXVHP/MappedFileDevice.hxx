@@ -0,0 +1,47 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_MAPPEDFILEDEVICE_HXX
+#define EXVHP_MAPPEDFILEDEVICE_HXX
+
+#include "MappedFile.hxx"
+#include "ReadOnlyDevice.hxx"
+#include <QSharedPointer>
+
+namespace eXVHP::Service {
+// MappedFile read with readAhead bytes prefetched ahead and released behind
+class MappedFileDevice : public ReadOnlyDevice {
+private:
+  QSharedPointer<MappedFile> m_file;
+  qint64 m_prefetchedPos;
+  qint64 m_releasedPos;
+
+protected:
+  bool openSource() override;
+  qint64 readData(char *data, qint64 maxSize) override;
+
+public:
+  static qint64 readAhead;
+
+  MappedFileDevice(QSharedPointer<MappedFile> file,
+                   QObject *parent = nullptr);
+  bool seek(qint64 pos) override;
+  qint64 size() const override;
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_MAPPEDFILEDEVICE_HXX
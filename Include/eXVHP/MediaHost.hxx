@@ -0,0 +1,32 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_MEDIAHOST_HXX
+#define EXVHP_MEDIAHOST_HXX
+
+namespace eXVHP::Service {
+enum class MediaHost {
+  Dubz,
+  Imgur,
+  JustStreamLive,
+  Streamable,
+  Streamff,
+  Streamja,
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_MEDIAHOST_HXX
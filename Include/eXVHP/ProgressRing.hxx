@@ -0,0 +1,60 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_PROGRESSRING_HXX
+#define EXVHP_PROGRESSRING_HXX
+
+#include <QAtomicInteger>
+#include <QFile>
+#include <QList>
+
+namespace eXVHP::Service {
+struct ProgressSnapshot {
+  // Identifies the upload only, it must not be dereferenced off the thread
+  // owning the MediaService
+  const QFile *videoFile = nullptr;
+  qint64 bytesSent = 0;
+  qint64 bytesTotal = 0;
+  double bytesPerSecond = 0;
+  double totalBytesPerSecond = 0;
+  qint64 timestamp = 0;
+};
+
+// Fixed-size single-producer single-consumer queue of progress snapshots.
+// The MediaService thread pushes, one other thread pops, and neither side
+// takes a lock. Snapshots pushed while the ring is full are dropped and
+// counted rather than blocking the producer.
+class ProgressRing {
+private:
+  alignas(64) QAtomicInteger<quint32> m_head;
+  alignas(64) QAtomicInteger<quint32> m_tail;
+  alignas(64) QAtomicInteger<quint32> m_dropped;
+  quint32 m_mask;
+  QList<ProgressSnapshot> m_slots;
+
+public:
+  static int defaultCapacity;
+
+  ProgressRing(int capacity = defaultCapacity);
+  int capacity() const;
+  quint32 dropped() const;
+  bool pop(ProgressSnapshot &snapshot);
+  bool push(const ProgressSnapshot &snapshot);
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_PROGRESSRING_HXX
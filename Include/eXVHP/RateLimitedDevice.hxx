@@ -0,0 +1,46 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_RATELIMITEDDEVICE_HXX
+#define EXVHP_RATELIMITEDDEVICE_HXX
+
+#include "RateLimiter.hxx"
+#include "ReadOnlyDevice.hxx"
+
+namespace eXVHP::Service {
+// Device read no faster than the rate limiter grants the host; readyRead
+// follows each refill
+class RateLimitedDevice : public ReadOnlyDevice {
+private:
+  QIODevice *m_device;
+  MediaHost m_host;
+  RateLimiter *m_rateLimiter;
+
+protected:
+  bool openSource() override;
+  qint64 readData(char *data, qint64 maxSize) override;
+
+public:
+  RateLimitedDevice(QIODevice *device, RateLimiter *rateLimiter,
+                    MediaHost host, QObject *parent = nullptr);
+  bool isSequential() const override;
+  bool seek(qint64 pos) override;
+  qint64 size() const override;
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_RATELIMITEDDEVICE_HXX
@@ -0,0 +1,66 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_RATELIMITER_HXX
+#define EXVHP_RATELIMITER_HXX
+
+#include "MediaHost.hxx"
+#include <QElapsedTimer>
+#include <QMap>
+#include <QTimer>
+
+namespace eXVHP::Service {
+// Token buckets shared by upload bodies, one global bucket and optional
+// per-host buckets, both in bytes per second. A rate of 0 leaves a bucket
+// unlimited. Rates can be changed while uploads are running, bodies pick the
+// new rate up on their next read.
+class RateLimiter : public QObject {
+  Q_OBJECT
+
+private:
+  struct Bucket {
+    qint64 lastRefill = 0;
+    qint64 rate = 0;
+    double tokens = 0;
+  };
+
+  QElapsedTimer m_clock;
+  Bucket m_globalBucket;
+  QMap<MediaHost, Bucket> m_hostBuckets;
+  QTimer m_refillTimer;
+  static qint64 capacity(qint64 rate);
+  void refill(Bucket &bucket);
+  void setBucketRate(Bucket &bucket, qint64 bytesPerSecond);
+
+public:
+  static int burstWindow;
+  static qint64 minimumGrant;
+  static int refillInterval;
+
+  RateLimiter(QObject *parent = nullptr);
+  qint64 acquire(MediaHost host, qint64 maxSize);
+  qint64 hostRate(MediaHost host) const;
+  qint64 rate() const;
+  void setHostRate(MediaHost host, qint64 bytesPerSecond);
+  void setRate(qint64 bytesPerSecond);
+
+signals:
+  void tokensAvailable();
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_RATELIMITER_HXX
@@ -0,0 +1,38 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_READONLYDEVICE_HXX
+#define EXVHP_READONLYDEVICE_HXX
+
+#include <QIODevice>
+
+namespace eXVHP::Service {
+// Base of the read-only body devices. Opens unbuffered, so pos() is where
+// the next readData() starts and nothing is read ahead of the consumer.
+class ReadOnlyDevice : public QIODevice {
+protected:
+  // Called by open() before the device itself opens
+  virtual bool openSource();
+  qint64 writeData(const char *data, qint64 maxSize) override;
+
+public:
+  ReadOnlyDevice(QObject *parent = nullptr);
+  bool open(OpenMode mode) override;
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_READONLYDEVICE_HXX
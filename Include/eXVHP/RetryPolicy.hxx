@@ -0,0 +1,70 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_RETRYPOLICY_HXX
+#define EXVHP_RETRYPOLICY_HXX
+
+#include "MediaHost.hxx"
+#include "UploadSpan.hxx"
+#include <QMap>
+#include <QNetworkReply>
+
+namespace eXVHP::Service {
+// How often and how soon a failed request phase is sent again. Rules are
+// kept per host and phase with one default for the rest; only transient
+// failures (dropped connections, timeouts, 408, 429 and 5xx) are retried.
+// The default rule covers the Token, Metadata and Poll phases only; sending
+// a body again can post the video twice, so other phases are retried only
+// when the connection failed before the request went out, unless a rule is
+// set for them.
+// Delays grow exponentially from baseDelay up to maxDelay, and a random
+// half of each delay is dropped so uploads failing together do not all
+// retry at the same moment.
+class RetryPolicy {
+public:
+  struct Rule {
+    // Attempts including the first, 1 disables retries
+    int maxAttempts;
+    int baseDelay;
+    int maxDelay;
+  };
+
+private:
+  Rule m_defaultRule;
+  QMap<QPair<MediaHost, UploadPhase>, Rule> m_rules;
+  static bool isIdempotent(UploadPhase phase);
+  static bool isUnsent(const QNetworkReply *reply);
+
+public:
+  static int defaultBaseDelay;
+  static int defaultMaxAttempts;
+  static int defaultMaxDelay;
+
+  RetryPolicy();
+  static int backoff(int attempt, int baseDelay, int maxDelay);
+  int delay(MediaHost host, UploadPhase phase, int attempt,
+            const QNetworkReply *reply = nullptr) const;
+  static bool isTransient(const QNetworkReply *reply);
+  Rule rule(MediaHost host, UploadPhase phase) const;
+  void setDefaultRule(const Rule &rule);
+  void setRule(MediaHost host, UploadPhase phase, const Rule &rule);
+  bool shouldRetry(MediaHost host, UploadPhase phase, int attempt,
+                   const QNetworkReply *reply) const;
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_RETRYPOLICY_HXX
@@ -0,0 +1,111 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_S3MULTIPARTUPLOAD_HXX
+#define EXVHP_S3MULTIPARTUPLOAD_HXX
+
+#include "AwsSigV4.hxx"
+#include "MediaHost.hxx"
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QUrlQuery>
+
+namespace eXVHP::Service {
+class RateLimiter;
+
+// Uploads a file to an S3 object as CreateMultipartUpload, concurrent
+// UploadPart requests over fixed-size ranges of the file and
+// CompleteMultipartUpload. Failed parts are retried on their own.
+class S3MultipartUpload : public QObject {
+  Q_OBJECT
+
+private:
+  struct Part {
+    int attempts;
+    qint64 bytesSent;
+    QByteArray eTag;
+    qint64 offset;
+    QNetworkReply *reply;
+    qint64 size;
+  };
+
+  bool m_aborted;
+  int m_completedParts;
+  QString m_fileName;
+  qint64 m_fileSize;
+  bool m_http2Allowed;
+  bool m_keepOnFailure;
+  int m_maxConcurrentParts;
+  int m_maxPartRetries;
+  QNetworkAccessManager *m_nam;
+  QList<Part> m_parts;
+  qint64 m_partSize;
+  QList<int> m_pendingParts;
+  QMap<int, QByteArray> m_resumeETags;
+  MediaHost m_rateLimitHost;
+  RateLimiter *m_rateLimiter;
+  int m_runningParts;
+  QString m_sessionToken;
+  AwsSigV4 m_signer;
+  QString m_uploadId;
+  QUrl m_url;
+  void abort(const QString &error, bool discard = false);
+  void complete();
+  void dispatchParts();
+  static QString parseErrorMessage(const QByteArray &xmlData);
+  static QString parseUploadId(const QByteArray &xmlData);
+  qint64 partBytesSent() const;
+  qint64 partBytesUploaded() const;
+  QNetworkRequest request(const QUrlQuery &query) const;
+  void uploadPart(int partIndex);
+
+public:
+  static int defaultMaxConcurrentParts;
+  static int defaultMaxPartRetries;
+  static qint64 defaultPartSize;
+  static qint64 minimumPartSize;
+
+  S3MultipartUpload(QNetworkAccessManager *nam, const QUrl &url,
+                    const QString &fileName, qint64 fileSize,
+                    const AwsSigV4 &signer, const QString &sessionToken,
+                    QObject *parent = nullptr);
+  qint64 bytesSent() const;
+  int retries() const;
+  void setHttp2Allowed(bool http2Allowed);
+  void setKeepOnFailure(bool keepOnFailure);
+  void setMaxConcurrentParts(int maxConcurrentParts);
+  void setMaxPartRetries(int maxPartRetries);
+  void setPartSize(qint64 partSize);
+  void setRateLimiter(RateLimiter *rateLimiter, MediaHost host);
+  void setResumeState(const QString &uploadId,
+                      const QMap<int, QByteArray> &partETags);
+
+public slots:
+  void cancel();
+  void start();
+
+signals:
+  void created(const QString &uploadId);
+  void failed(const QString &error);
+  void finished();
+  void partUploaded(int partNumber, const QByteArray &eTag,
+                    qint64 bytesUploaded);
+  void uploadProgress(qint64 bytesSent, qint64 bytesTotal);
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_S3MULTIPARTUPLOAD_HXX
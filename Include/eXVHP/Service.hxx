@@ -18,49 +18,281 @@
 #ifndef EXVHP_SERVICE_HXX
 #define EXVHP_SERVICE_HXX
 
+#include "AwsSigV4.hxx"
+#include "DubzLinkIdScanner.hxx"
+#include "FileHashCache.hxx"
+#include "MappedFile.hxx"
+#include "MediaHost.hxx"
+#include "RetryPolicy.hxx"
+#include "SharedFileReader.hxx"
+#include "UploadBatch.hxx"
+#include "UploadCache.hxx"
+#include "UploadJob.hxx"
+#include "UploadJournal.hxx"
+#include "UploadMetrics.hxx"
+#include "UploadProgress.hxx"
+#include "UploadResult.hxx"
+#include <QElapsedTimer>
 #include <QFile>
+#include <QFuture>
+#include <QHash>
+#include <QMap>
 #include <QNetworkAccessManager>
-#include <QRegularExpression>
+#include <QPromise>
+#include <QSharedPointer>
+#include <QTimer>
+#include <functional>
 
 namespace eXVHP::Service {
+class FormDataDevice;
+class ImgurTicketPoller;
+class RateLimiter;
+class UploadTokenPool;
+
 class MediaService : public QObject {
   Q_OBJECT
 
+public:
+  // Base URLs every request is built from, so uploads can be pointed at a
+  // local stand-in instead of the real hosts
+  enum class Endpoint {
+    Dubz,
+    ImgurApi,
+    ImgurBase,
+    JustStreamLiveApi,
+    JustStreamLiveBase,
+    StreamableApi,
+    StreamableAws,
+    StreamableBase,
+    Streamff,
+    Streamja,
+  };
+
+  enum class StreamableUploadMode {
+    // Hash the whole file on a worker thread, then PUT it with a signed
+    // payload hash
+    SignedPayload,
+    // Sign each chunk as it is sent (aws-chunked), reading the file once
+    StreamingPayload,
+    // Send fixed-size parts concurrently as an S3 multipart upload
+    Multipart,
+  };
+
 private:
+  struct FanOutHandle {
+    MediaHost host;
+    QSharedPointer<SharedFileReader> reader;
+    QFile *videoFile;
+    // Whether upload() was called for the host yet
+    bool started;
+  };
+
+  struct ImgurTicket {
+    QString videoTitle;
+    QFile *videoFile;
+    qint64 queuedAt;
+  };
+
+  struct PendingResult {
+    MediaHost host;
+    QSharedPointer<QPromise<UploadResult>> promise;
+  };
+
+  struct Race {
+    QElapsedTimer timer;
+    QMap<MediaHost, qint64> hostElapsed;
+    bool canceled;
+    bool won;
+    MediaHost winner;
+  };
+
+  UploadCache m_cache;
+  QHash<QFile *, QFuture<QByteArray>> m_cacheDigests;
+  QHash<QFile *, QString> m_cacheKeys;
+  QHash<QFile *, QByteArray> m_contentDigests;
+  QString m_dubzUrl;
+  QString m_imgurApiUrl;
+  QString m_imgurBaseUrl;
+  ImgurTicketPoller *m_imgurPoller;
+  QHash<QString, ImgurTicket> m_imgurTickets;
+  QHash<QFile *, FanOutHandle> m_fanOutHandles;
+  bool m_http2Allowed;
+  UploadJobPool m_jobPool;
+  QHash<QFile *, UploadJob *> m_jobs;
+  UploadJournal m_journal;
+  QHash<QFile *, QString> m_journalKeys;
+  QString m_jslApiUrl;
+  QString m_jslBaseUrl;
+  QHash<QFile *, QSharedPointer<MappedFile>> m_mappedFiles;
+  QHash<QNetworkReply *, DubzLinkIdScanner> m_linkIdScanners;
+  UploadMetrics m_metrics;
   QNetworkAccessManager *m_nam;
-  static QRegularExpression dubzlinkIdRegex;
-  static QString dubzParseLinkId(const QString &homePageData);
-  static QString dubzUrl;
-  static QString imgurApiUrl;
-  static QString imgurBaseUrl;
+  UploadProgress m_progress;
+  ProgressRing *m_progressRing;
+  QTimer m_progressTimer;
+  QHash<QFile *, Race> m_races;
+  RateLimiter *m_rateLimiter;
+  RetryPolicy m_retryPolicy;
+  QString m_sabApiUrl;
+  QString m_sabAwsUrl;
+  QString m_sabBaseUrl;
+  int m_sabMaxConcurrentParts;
+  int m_sabMaxPartRetries;
+  qint64 m_sabPartSize;
+  QString m_sffBaseUrl;
+  QString m_sjaBaseUrl;
+  StreamableUploadMode m_streamableUploadMode;
+  UploadTokenPool *m_tokenPool;
+  QHash<QFile *, PendingResult> m_uploadResults;
+  QMultiHash<QFile *, QObject *> m_uploadTasks;
+  FormDataDevice *bodyForm(UploadJob *job, const QString &fieldName);
+  bool cacheLookup(UploadJob *job);
+  void dubzUploadVideo(UploadJob *job);
+  void fanOutError(QFile *hostFile, const QString &error);
+  void fanOutProgress(QFile *hostFile, qint64 bytesSent, qint64 bytesTotal);
+  void fanOutRelease(QFile *hostFile);
+  void fanOutUploaded(QFile *hostFile, const QString &videoId,
+                      const QString &videoLink);
+  void finishJob(QFile *videoFile);
+  void flushProgress();
+  QStringList hostUrls(MediaHost host) const;
+  void imgurCheckCaptcha(UploadJob *job);
   static QString imgurClientId;
-  static QString jslApiUrl;
-  static QString jslBaseUrl;
-  static QString sabApiUrl;
-  static QString sabAwsUrl;
-  static QString sabBaseUrl;
+  void imgurTicketDone(const QString &ticket, const QString &videoId,
+                       const QString &videoDeletehash);
+  void imgurTicketFailed(const QString &ticket, const QString &error);
+  void imgurUpdateTitle(QFile *videoFile, const QString &videoTitle,
+                        const QString &videoId, const QString &videoDeletehash);
+  void imgurUploadVideo(UploadJob *job);
+  bool journalResume(UploadJob *job);
+  void journalRecord(QFile *videoFile, MediaHost host,
+                     const QJsonObject &fields);
+  void jslUploadVideo(UploadJob *job);
+  UploadJob *liveJob(QFile *videoFile, quint64 jobId) const;
+  QSharedPointer<MappedFile> mapFile(QFile *videoFile);
+  QIODevice *openBody(UploadJob *job);
+  static UploadSpan phaseSpan(MediaHost host, UploadPhase phase,
+                              qint64 startTime);
+  static QString parseUploadToken(MediaHost host, const QByteArray &respData);
+  QFuture<QByteArray> payloadHash(QFile *videoFile);
+  QNetworkReply *postForm(MediaHost host, QNetworkRequest req,
+                          FormDataDevice *formData);
+  void publishProgress(QFile *videoFile);
+  void reportProgress(QFile *videoFile, qint64 bytesSent, qint64 bytesTotal);
+  void resolveUpload(QFile *videoFile, UploadResult result);
+  QNetworkRequest request(const QUrl &url) const;
+  void requestJobToken(UploadJob *job);
+  QNetworkReply *requestUploadToken(MediaHost host);
+  bool retryPhase(UploadJob *job, QNetworkReply *reply,
+                  const std::function<void()> &rerun);
   static QString sabReactVersion;
-  static QString sffBaseUrl;
-  static QString sjaBaseUrl;
+  void sabRequestShortcode(UploadJob *job, StreamableUploadMode uploadMode);
+  void sabTranscode(UploadJob *job);
+  void sabUpdateMetadata(UploadJob *job, StreamableUploadMode uploadMode);
+  QNetworkRequest sabUploadRequest(const UploadJob *job) const;
+  void sabUploadBody(UploadJob *job, StreamableUploadMode uploadMode);
+  void sabUploadMultipart(UploadJob *job);
+  void sabUploadSigned(UploadJob *job, const QByteArray &payloadDigest);
+  void sabUploadStreaming(UploadJob *job);
+  void sabWatchUpload(QNetworkReply *uploadResp, UploadJob *job,
+                      const std::function<void()> &resend);
+  QNetworkReply *sendBody(MediaHost host,
+                          QNetworkAccessManager::Operation operation,
+                          QNetworkRequest req, QIODevice *body);
+  void sffUploadVideo(UploadJob *job);
+  void sjaUploadVideo(UploadJob *job);
+  bool stopTasks(QFile *videoFile);
+  UploadJob *startJob(MediaHost host, QFile *videoFile,
+                      const QString &videoMimeType);
+  void traceReply(QFile *videoFile, MediaHost host, UploadPhase phase,
+                  QNetworkReply *reply);
+  void traceSpan(QFile *videoFile, const UploadSpan &span);
+  void trackTask(QFile *videoFile, QObject *task);
+  QString uploadToken(MediaHost host, QNetworkReply *tokenResp);
+
+  friend class UploadBatch;
+  friend class UploadTokenPool;
 
 public:
   MediaService(QNetworkAccessManager *nam = nullptr, QObject *parent = nullptr);
+  const UploadMetrics &metrics() const;
+  void resetMetrics();
+  const RetryPolicy &retryPolicy() const;
+  void setHttp2Allowed(bool http2Allowed);
+  void setEndpoint(Endpoint endpoint, const QString &baseUrl);
+  static void
+  setHashCachePath(const QString &cachePath,
+                   int maxEntries = FileHashCache::defaultMaxEntries);
+  void setHostRateLimit(MediaHost host, qint64 bytesPerSecond);
+  bool setJournalPath(const QString &journalPath);
+  void setProgressInterval(int interval);
+  void setProgressRing(ProgressRing *progressRing);
+  void setRateLimit(qint64 bytesPerSecond);
+  void setRetryPolicy(const RetryPolicy &retryPolicy);
+  void setStreamableMultipartOptions(qint64 partSize, int maxConcurrentParts,
+                                     int maxPartRetries);
+  void setStreamableUploadMode(StreamableUploadMode uploadMode);
+  void setTokenPoolTarget(MediaHost host, int targetSize, int tokenLifetime);
+  bool setUploadCache(const QString &cachePath,
+                      int maxAge = UploadCache::defaultMaxAge,
+                      int maxEntries = UploadCache::defaultMaxEntries);
+  double throughput() const;
+
+  // Starts the upload like upload() and returns its result as a future,
+  // so uploads can be chained with then() or joined with QtFuture::whenAll
+  // and QtFuture::whenAny; include UploadAwaitable.hxx to co_await it. A
+  // file already uploading through this call returns the same future; one
+  // uploading through upload() is joined, and its host is reported.
+  QFuture<UploadResult> uploadAsync(MediaHost host, QFile *videoFile,
+                                    const QString &videoTitle = QString(),
+                                    const QString &awsRegion = QString());
+  // Phase the upload of a file last entered and whether it is still running
+  // or canceled; a file without an upload reports Idle
+  UploadPhase uploadPhase(QFile *videoFile) const;
+  UploadJob::Status uploadStatus(QFile *videoFile) const;
 
 public slots:
+  void cancel(QFile *videoFile);
+  void resumeJournal();
+  void upload(MediaHost host, QFile *videoFile,
+              const QString &videoTitle = QString(),
+              const QString &awsRegion = QString());
+  UploadBatch *uploadBatch(const QList<QFile *> &videoFiles, MediaHost host,
+                           const UploadBatch::Options &options =
+                               UploadBatch::Options());
   void uploadDubz(QFile *videoFile, const QString &videoTitle);
+  void uploadFanOut(QFile *videoFile, const QList<MediaHost> &hosts,
+                    const QString &videoTitle = QString(),
+                    const QString &awsRegion = QString());
   void uploadImgur(QFile *videoFile, const QString &videoTitle);
   void uploadJustStreamLive(QFile *videoFile);
+  void uploadRace(QFile *videoFile, const QList<MediaHost> &hosts,
+                  const QString &videoTitle = QString(),
+                  const QString &awsRegion = QString());
   void uploadStreamable(QFile *videoFile, const QString &videoTitle,
                         const QString &awsRegion);
   void uploadStreamff(QFile *videoFile);
   void uploadStreamja(QFile *videoFile);
+  void warmUp();
+  void warmUp(const QList<MediaHost> &hosts);
 
 signals:
+  void fanOutFinished(QFile *videoFile);
+  void hostMediaUploaded(MediaHost host, QFile *videoFile,
+                         const QString &videoId, const QString &videoLink);
+  void hostMediaUploadError(MediaHost host, QFile *videoFile,
+                            const QString &error);
+  void hostMediaUploadProgress(MediaHost host, QFile *videoFile,
+                               qint64 bytesSent, qint64 bytesTotal);
   void mediaUploaded(QFile *videoFile, const QString &videoId,
                      const QString &videoLink);
   void mediaUploadError(QFile *videoFile, const QString &error);
   void mediaUploadProgress(QFile *videoFile, qint64 bytesSent,
                            qint64 bytesTotal);
+  void raceFinished(QFile *videoFile, bool won, MediaHost winner,
+                    const QMap<MediaHost, qint64> &hostElapsed);
+  void uploadResumed(QFile *videoFile, MediaHost host);
+  void uploadSpan(QFile *videoFile, const UploadSpan &span);
 };
 } // namespace eXVHP::Service
 
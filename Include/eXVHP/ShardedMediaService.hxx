@@ -0,0 +1,89 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_SHARDEDMEDIASERVICE_HXX
+#define EXVHP_SHARDEDMEDIASERVICE_HXX
+
+#include "Service.hxx"
+#include <QAtomicInteger>
+#include <QPointer>
+#include <QThread>
+#include <functional>
+
+namespace eXVHP::Service {
+// Spreads uploads over several MediaService shards, each on its own worker
+// thread with its own QNetworkAccessManager, so TLS, form encoding, JSON
+// and signing run on more than one core. Results are reported with the
+// caller's QFile from whichever worker finished them and reach receivers in
+// the caller's thread as queued calls. The caller keeps ownership of the
+// QFile it passes; each shard reads the file through its own handle.
+class ShardedMediaService : public QObject {
+  Q_OBJECT
+
+public:
+  enum class DispatchPolicy {
+    // Shard with the fewest uploads in flight
+    LeastLoaded,
+    // Same shard for every upload to a host, so its connections, tokens
+    // and rate limits stay in one place
+    HostAffinity,
+  };
+
+private:
+  struct Shard {
+    QObject *context;
+    QAtomicInteger<int> load;
+    MediaService *service;
+    QThread *thread;
+    // Only touched on the shard's worker thread
+    QHash<QFile *, QFile *> callerFiles;
+    QHash<QFile *, QPointer<QFile>> shardFiles;
+  };
+
+  QHash<QFile *, int> m_callerShards;
+  DispatchPolicy m_dispatchPolicy;
+  QList<Shard *> m_shards;
+  void forward(Shard *shard);
+  int pickShard(MediaHost host) const;
+  void shardFinished(Shard *shard, QFile *shardFile);
+
+public:
+  ShardedMediaService(int shardCount = QThread::idealThreadCount(),
+                      QObject *parent = nullptr);
+  ~ShardedMediaService();
+  void configure(const std::function<void(MediaService *)> &configure);
+  int load(int shard) const;
+  void setDispatchPolicy(DispatchPolicy dispatchPolicy);
+  int shardCount() const;
+
+public slots:
+  void cancel(QFile *videoFile);
+  void upload(MediaHost host, QFile *videoFile,
+              const QString &videoTitle = QString(),
+              const QString &awsRegion = QString());
+
+signals:
+  void mediaUploaded(QFile *videoFile, const QString &videoId,
+                     const QString &videoLink);
+  void mediaUploadError(QFile *videoFile, const QString &error);
+  void mediaUploadProgress(QFile *videoFile, qint64 bytesSent,
+                           qint64 bytesTotal);
+  void uploadSpan(QFile *videoFile, const UploadSpan &span);
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_SHARDEDMEDIASERVICE_HXX
@@ -0,0 +1,47 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_SHAREDFILEDEVICE_HXX
+#define EXVHP_SHAREDFILEDEVICE_HXX
+
+#include "ReadOnlyDevice.hxx"
+#include "SharedFileReader.hxx"
+#include <QSharedPointer>
+
+namespace eXVHP::Service {
+// File read through a SharedFileReader as the given consumer
+class SharedFileDevice : public ReadOnlyDevice {
+private:
+  QByteArray m_chunk;
+  qint64 m_chunkIndex;
+  const QObject *m_consumer;
+  QSharedPointer<SharedFileReader> m_reader;
+
+protected:
+  bool openSource() override;
+  qint64 readData(char *data, qint64 maxSize) override;
+
+public:
+  SharedFileDevice(QSharedPointer<SharedFileReader> reader,
+                   const QObject *consumer, QObject *parent = nullptr);
+  void close() override;
+  bool seek(qint64 pos) override;
+  qint64 size() const override;
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_SHAREDFILEDEVICE_HXX
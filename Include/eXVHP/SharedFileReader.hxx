@@ -0,0 +1,59 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_SHAREDFILEREADER_HXX
+#define EXVHP_SHAREDFILEREADER_HXX
+
+#include <QFile>
+#include <QHash>
+#include <QMap>
+
+namespace eXVHP::Service {
+// Reads a file once on behalf of several consumers, registered as they start
+// reading. Each chunk is kept until every consumer has read past it, with at
+// most maxChunks kept ahead of the slowest consumer. A consumer outside that
+// window, such as one that started behind it, reads from disk directly
+// without pulling the window back, so no consumer ever waits for another.
+class SharedFileReader {
+private:
+  QMap<qint64, QByteArray> m_chunks;
+  qint64 m_chunkSize;
+  QHash<const QObject *, qint64> m_consumers;
+  QFile m_file;
+  int m_maxChunks;
+  qint64 m_windowStart;
+  void evict();
+
+public:
+  static qint64 defaultChunkSize;
+  static int defaultMaxChunks;
+
+  SharedFileReader(const QString &fileName,
+                   qint64 chunkSize = defaultChunkSize,
+                   int maxChunks = defaultMaxChunks);
+  void addConsumer(const QObject *consumer);
+  QByteArray chunk(qint64 index);
+  qint64 chunkSize() const;
+  QString errorString() const;
+  bool open();
+  void removeConsumer(const QObject *consumer);
+  void setConsumerPos(const QObject *consumer, qint64 pos);
+  qint64 size() const;
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_SHAREDFILEREADER_HXX
@@ -0,0 +1,73 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_UPLOADAWAITABLE_HXX
+#define EXVHP_UPLOADAWAITABLE_HXX
+
+#include "UploadResult.hxx"
+#include <QFuture>
+
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+
+namespace eXVHP::Service {
+// Lets a C++20 coroutine write
+//
+//   UploadResult result = co_await service->uploadAsync(host, videoFile);
+//
+// The service finishes its futures from its own event loop, so the
+// coroutine resumes on the service's thread outside of any result signal.
+// No thread or QObject is created per await; the only allocation is the
+// continuation QFuture attaches to the shared state.
+class UploadAwaiter {
+private:
+  QFuture<UploadResult> m_future;
+
+public:
+  explicit UploadAwaiter(const QFuture<UploadResult> &future)
+      : m_future(future) {}
+
+  bool await_ready() const { return m_future.isFinished(); }
+
+  void await_suspend(std::coroutine_handle<> handle) {
+    m_future
+        .then(QtFuture::Launch::Sync,
+              [handle](const UploadResult &) { handle.resume(); })
+        .onCanceled([handle]() { handle.resume(); });
+  }
+
+  // A future canceled because the service went away reports an error
+  // instead of leaving the coroutine suspended
+  UploadResult await_resume() const {
+    if (m_future.isCanceled()) {
+      UploadResult result;
+      result.error = "Upload canceled!";
+      return result;
+    }
+
+    return m_future.result();
+  }
+};
+
+// Found through argument-dependent lookup on UploadResult
+inline UploadAwaiter operator co_await(const QFuture<UploadResult> &future) {
+  return UploadAwaiter(future);
+}
+} // namespace eXVHP::Service
+#endif
+
+#endif // EXVHP_UPLOADAWAITABLE_HXX
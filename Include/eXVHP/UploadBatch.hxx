@@ -0,0 +1,99 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_UPLOADBATCH_HXX
+#define EXVHP_UPLOADBATCH_HXX
+
+#include "MediaHost.hxx"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+
+namespace eXVHP::Service {
+class MediaService;
+class UploadTokenPool;
+
+// Uploads a list of files to one host with a few bodies in flight at once.
+// While those are sent, upload identifiers for the files after them are
+// already being fetched into the service's token pool, so each new body
+// starts without a token round trip of its own. Streamable, Imgur and
+// JustStreamLive have no identifiers to fetch ahead and only get the
+// concurrency. A batch from MediaService::uploadBatch() starts once control
+// returns to the event loop, so its signals can be connected first, and
+// deletes itself after finished.
+class UploadBatch : public QObject {
+  Q_OBJECT
+
+public:
+  struct Options {
+    // Bodies sent at once
+    int maxRunning = 2;
+    // Identifiers kept fetched ahead of the running bodies
+    int prefetch = 4;
+    QString videoTitle;
+    QString awsRegion;
+  };
+
+private:
+  qint64 m_bytesTotal;
+  qint64 m_bytesUploaded;
+  bool m_dispatching;
+  QElapsedTimer m_elapsedTimer;
+  int m_failed;
+  QHash<QFile *, qint64> m_fileSizes;
+  bool m_finished;
+  MediaHost m_host;
+  Options m_options;
+  QList<QFile *> m_pendingFiles;
+  int m_reservedTokens;
+  QHash<QFile *, qint64> m_runningBytes;
+  MediaService *m_service;
+  int m_succeeded;
+  QPointer<UploadTokenPool> m_tokenPool;
+  void dispatch();
+  void fileFinished(QFile *videoFile, bool uploaded);
+  void reserveTokens();
+  void reportProgress();
+
+public:
+  UploadBatch(MediaService *service, MediaHost host,
+              const QList<QFile *> &videoFiles, const Options &options,
+              QObject *parent = nullptr);
+  ~UploadBatch();
+  qint64 bytesUploaded() const;
+  int completedCount() const;
+  int fileCount() const;
+  double throughput() const;
+
+public slots:
+  void cancel();
+  void start();
+
+signals:
+  void batchProgress(int filesCompleted, int fileCount, qint64 bytesSent,
+                     qint64 bytesTotal);
+  void fileUploadError(QFile *videoFile, const QString &error);
+  void fileUploaded(QFile *videoFile, const QString &videoId,
+                    const QString &videoLink);
+  void finished(int succeeded, int failed, qint64 elapsedMs,
+                double bytesPerSecond);
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_UPLOADBATCH_HXX
@@ -0,0 +1,55 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_UPLOADCACHE_HXX
+#define EXVHP_UPLOADCACHE_HXX
+
+#include "MediaHost.hxx"
+#include <QJsonObject>
+
+namespace eXVHP::Service {
+// Remembers successful uploads in a JSON file, keyed by host and the SHA-256
+// of the file's content, so a file uploaded before can be answered with the
+// earlier video instead of being sent again. Entries expire after maxAge
+// seconds and the oldest are dropped beyond maxEntries.
+class UploadCache {
+private:
+  QJsonObject m_entries;
+  int m_maxAge;
+  int m_maxEntries;
+  QString m_path;
+  void prune();
+  void save() const;
+
+public:
+  static int defaultMaxAge;
+  static int defaultMaxEntries;
+
+  UploadCache();
+  void close();
+  QJsonObject entry(const QString &entryKey) const;
+  static QString entryKey(MediaHost host, const QByteArray &digest);
+  void insert(const QString &entryKey, const QString &videoId,
+              const QString &videoLink);
+  bool isOpen() const;
+  bool open(const QString &path, int maxAge = defaultMaxAge,
+            int maxEntries = defaultMaxEntries);
+  void remove(const QString &entryKey);
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_UPLOADCACHE_HXX
@@ -0,0 +1,91 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_UPLOADJOB_HXX
+#define EXVHP_UPLOADJOB_HXX
+
+#include "AwsSigV4.hxx"
+#include "MediaHost.hxx"
+#include "UploadSpan.hxx"
+#include <QFile>
+#include <QFuture>
+#include <QList>
+
+namespace eXVHP::Service {
+// Everything one upload carries from phase to phase. The service holds one
+// job per upload and hands it to each phase by pointer. Jobs are reused, so
+// callbacks that may run after the upload finished capture the job's ID and
+// look the job up again.
+struct UploadJob {
+  enum class Status {
+    // No upload is running for the file
+    Idle,
+    Running,
+    // Canceled, waiting for its tasks to report the abort
+    Canceling,
+  };
+
+  // Unique for every upload the job runs, 0 while it is pooled
+  quint64 id = 0;
+  MediaHost host = MediaHost::Dubz;
+  UploadPhase phase = UploadPhase::Token;
+  // Requests sent so far for the current phase
+  int attempts = 0;
+  Status status = Status::Idle;
+  qint64 startTime = 0;
+  QFile *videoFile = nullptr;
+  QString videoFileName;
+  qint64 videoSize = 0;
+  QString videoMimeType;
+  QString videoTitle;
+  QString awsRegion;
+  // Dubz link ID, Streamable shortcode, Streamff video ID or Streamja
+  // short ID
+  QString token;
+  QString accessKeyId;
+  QString secretAccessKey;
+  QString sessionToken;
+  QString transcoderToken;
+  QFuture<QByteArray> payloadHash;
+  // Set once the body is first sent; the file is then deleted when the
+  // upload reports its result, so a failed body can be sent again
+  bool ownsFile = false;
+
+  AwsSigV4 signer() const;
+};
+
+// Free list of finished jobs, so a steady stream of uploads reuses the
+// same few job objects instead of allocating one each
+class UploadJobPool {
+private:
+  QList<UploadJob *> m_idleJobs;
+  int m_maxIdle;
+  quint64 m_nextId;
+  Q_DISABLE_COPY(UploadJobPool)
+
+public:
+  static int defaultMaxIdle;
+
+  UploadJobPool(int maxIdle = defaultMaxIdle);
+  ~UploadJobPool();
+  UploadJob *acquire();
+  int idleCount() const;
+  void release(UploadJob *job);
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_UPLOADJOB_HXX
@@ -0,0 +1,54 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_UPLOADJOURNAL_HXX
+#define EXVHP_UPLOADJOURNAL_HXX
+
+#include "MediaHost.hxx"
+#include <QJsonObject>
+#include <QStringList>
+
+namespace eXVHP::Service {
+// Keeps the phase and identifiers of every unfinished upload in a JSON file
+// so a failed or interrupted upload can continue where it stopped. Jobs are
+// keyed by host and file, including the file's size and modification time so
+// a changed file starts over. Jobs may hold temporary upload credentials, so
+// the file is only readable by its owner.
+class UploadJournal {
+private:
+  QJsonObject m_jobs;
+  int m_maxAge;
+  QString m_path;
+  void save() const;
+
+public:
+  static int defaultMaxAge;
+  static int maxResumeAttempts;
+
+  UploadJournal();
+  void close();
+  bool isOpen() const;
+  QJsonObject job(const QString &jobKey) const;
+  static QString jobKey(MediaHost host, const QString &fileName);
+  QStringList jobKeys() const;
+  bool open(const QString &path, int maxAge = defaultMaxAge);
+  void removeJob(const QString &jobKey);
+  void updateJob(const QString &jobKey, const QJsonObject &fields);
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_UPLOADJOURNAL_HXX
@@ -0,0 +1,54 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_UPLOADMETRICS_HXX
+#define EXVHP_UPLOADMETRICS_HXX
+
+#include "UploadSpan.hxx"
+#include <QList>
+#include <QMap>
+
+namespace eXVHP::Service {
+// Aggregates upload spans into fixed-bucket duration histograms per host and
+// phase. Recording a span is a bucket search and a few additions, cheap
+// enough to leave on for every upload.
+class UploadMetrics {
+private:
+  struct Histogram {
+    QList<quint64> bucketCounts;
+    quint64 count = 0;
+    double durationSum = 0;
+    quint64 errors = 0;
+    quint64 retries = 0;
+    qint64 bytesSent = 0;
+  };
+
+  QMap<QPair<MediaHost, UploadPhase>, Histogram> m_histograms;
+  static QList<double> bucketBounds;
+  static double quantile(const Histogram &histogram, double q);
+
+public:
+  static QString hostLabel(MediaHost host);
+  static QString phaseLabel(UploadPhase phase);
+  double percentile(MediaHost host, UploadPhase phase, double q) const;
+  QString prometheusText() const;
+  void record(const UploadSpan &span);
+  void reset();
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_UPLOADMETRICS_HXX
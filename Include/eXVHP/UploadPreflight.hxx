@@ -0,0 +1,84 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_UPLOADPREFLIGHT_HXX
+#define EXVHP_UPLOADPREFLIGHT_HXX
+
+#include "MediaHost.hxx"
+#include <QFuture>
+#include <QList>
+#include <QMap>
+#include <QThreadPool>
+
+namespace eXVHP::Service {
+// Checks a file against what a host accepts before anything is sent. The
+// container is identified from the file's content rather than its extension:
+// an MP4 or QuickTime file by a top-level ftyp or moov box, following the
+// top-level boxes past a leading mdat, free or wide box, and a Matroska or
+// WebM file by its EBML DocType. The ftyp major brand tells QuickTime
+// ("qt  ") from MP4; a moov box with no ftyp before it is QuickTime.
+class UploadPreflight {
+public:
+  enum class ContainerFormat {
+    Unknown,
+    Matroska,
+    Mp4,
+    QuickTime,
+    WebM,
+  };
+
+  struct HostCapability {
+    QList<ContainerFormat> formats;
+    qint64 maxSize;
+    QString formatError;
+    QString sizeError;
+  };
+
+  struct Result {
+    QString fileName;
+    MediaHost host;
+    ContainerFormat format;
+    QString mimeType;
+    QString error;
+  };
+
+private:
+  static QMap<MediaHost, HostCapability> capabilities;
+  static int maxProbeBoxes;
+  static qint64 probeSize;
+  static ContainerFormat boxFormat(const QByteArray &boxData);
+  static bool isBoxType(const QByteArray &boxType);
+  static bool readBox(const QByteArray &data, qsizetype pos, quint64 &boxSize,
+                      QByteArray &boxType);
+  static bool readVint(const QByteArray &data, qsizetype &pos,
+                       bool keepMarker, quint64 &value);
+
+public:
+  static HostCapability capability(MediaHost host);
+  static Result check(MediaHost host, const QString &fileName);
+  // Checks every (host, file) pair on worker threads; results keep the order
+  // of the input
+  static QFuture<Result>
+  checkAll(const QList<QPair<MediaHost, QString>> &uploads,
+           QThreadPool *pool = QThreadPool::globalInstance());
+  static QString mimeType(ContainerFormat format);
+  static ContainerFormat probe(const QByteArray &header);
+  static ContainerFormat probeFile(const QString &fileName);
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_UPLOADPREFLIGHT_HXX
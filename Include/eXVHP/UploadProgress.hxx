@@ -0,0 +1,61 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_UPLOADPROGRESS_HXX
+#define EXVHP_UPLOADPROGRESS_HXX
+
+#include "ProgressRing.hxx"
+#include <QElapsedTimer>
+#include <QHash>
+
+namespace eXVHP::Service {
+// Coalesces upload progress per file to at most one update per interval and
+// keeps a smoothed send rate per file and across all files. The last update
+// of an upload (everything sent) is never held back.
+class UploadProgress {
+private:
+  struct Entry {
+    qint64 bytesSent = 0;
+    qint64 bytesTotal = 0;
+    double bytesPerSecond = 0;
+    bool pending = false;
+    qint64 reportTime = -1;
+    qint64 sampleBytes = 0;
+    qint64 sampleTime = 0;
+  };
+
+  QElapsedTimer m_clock;
+  QHash<QFile *, Entry> m_entries;
+  int m_interval;
+
+public:
+  static int defaultInterval;
+  static int sampleInterval;
+
+  UploadProgress();
+  int interval() const;
+  int nextDue() const;
+  void remove(QFile *videoFile);
+  void setInterval(int interval);
+  ProgressSnapshot snapshot(QFile *videoFile);
+  QList<QFile *> takeDue();
+  double throughput() const;
+  bool update(QFile *videoFile, qint64 bytesSent, qint64 bytesTotal);
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_UPLOADPROGRESS_HXX
@@ -0,0 +1,38 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_UPLOADRESULT_HXX
+#define EXVHP_UPLOADRESULT_HXX
+
+#include "MediaHost.hxx"
+#include <QFile>
+#include <QString>
+
+namespace eXVHP::Service {
+// Outcome of one upload started with MediaService::uploadAsync(). The file
+// pointer identifies the upload only; the service may have deleted it.
+struct UploadResult {
+  QFile *videoFile = nullptr;
+  MediaHost host = MediaHost::Dubz;
+  bool uploaded = false;
+  QString videoId;
+  QString videoLink;
+  QString error;
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_UPLOADRESULT_HXX
@@ -0,0 +1,83 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_UPLOADSCHEDULER_HXX
+#define EXVHP_UPLOADSCHEDULER_HXX
+
+#include "Service.hxx"
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMap>
+
+namespace eXVHP::Service {
+// Queues uploads in front of a MediaService and starts them by priority,
+// within a global in-flight cap and per-host caps. Hosts with queued uploads
+// of equal priority take turns so one busy host cannot starve the others.
+class UploadScheduler : public QObject {
+  Q_OBJECT
+
+private:
+  struct QueuedUpload {
+    QString awsRegion;
+    QElapsedTimer enqueueTimer;
+    int priority;
+    QString videoTitle;
+    QFile *videoFile;
+  };
+
+  bool m_dispatching;
+  QMap<MediaHost, int> m_hostLimits;
+  QMap<MediaHost, QList<QueuedUpload>> m_hostQueues;
+  QMap<MediaHost, int> m_hostRunning;
+  MediaHost m_lastStartedHost;
+  int m_maxRunning;
+  int m_queueDepth;
+  QHash<QFile *, MediaHost> m_queuedUploads;
+  QHash<QFile *, MediaHost> m_runningUploads;
+  MediaService *m_service;
+  void dispatch();
+  int hostLimit(MediaHost host) const;
+  void uploadFinished(QFile *videoFile);
+
+public:
+  static int defaultHostLimit;
+  static int defaultMaxRunning;
+
+  UploadScheduler(MediaService *service, QObject *parent = nullptr);
+  int queueDepth() const;
+  int runningCount() const;
+  void setHostLimit(MediaHost host, int limit);
+  void setMaxRunning(int maxRunning);
+
+public slots:
+  // A file already queued or running is not queued again; returns whether
+  // the file was queued
+  bool enqueue(MediaHost host, QFile *videoFile,
+               const QString &videoTitle = QString(),
+               const QString &awsRegion = QString(), int priority = 0);
+  // Takes a queued file off its queue; running uploads are canceled through
+  // the service. Returns whether the file was queued.
+  bool remove(QFile *videoFile);
+
+signals:
+  void queueDepthChanged(int queueDepth);
+  void runningCountChanged(int runningCount);
+  void uploadStarted(QFile *videoFile, MediaHost host, qint64 waitMs);
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_UPLOADSCHEDULER_HXX
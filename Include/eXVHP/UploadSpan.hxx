@@ -0,0 +1,57 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_UPLOADSPAN_HXX
+#define EXVHP_UPLOADSPAN_HXX
+
+#include "MediaHost.hxx"
+#include <QString>
+
+namespace eXVHP::Service {
+enum class UploadPhase {
+  // No upload running for the file; never reported in a span
+  Idle,
+  // Identifier request: Dubz home page, Imgur captcha check, Streamable
+  // shortcode, Streamff link or Streamja short ID
+  Token,
+  // Streamable video metadata or Imgur title update
+  Metadata,
+  // Waiting on the Streamable payload hash
+  Hash,
+  Body,
+  Transcode,
+  // Imgur ticket from upload until it resolves
+  Poll,
+};
+
+// One timed phase of one upload. Times are milliseconds since the epoch;
+// httpStatus is 0 for phases without a request of their own.
+struct UploadSpan {
+  MediaHost host;
+  UploadPhase phase;
+  qint64 startTime;
+  qint64 endTime;
+  qint64 bytesSent;
+  qint64 bytesReceived;
+  int httpStatus;
+  int retries;
+  bool connectionReused;
+  QString error;
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_UPLOADSPAN_HXX
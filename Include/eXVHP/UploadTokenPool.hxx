@@ -0,0 +1,79 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXVHP_UPLOADTOKENPOOL_HXX
+#define EXVHP_UPLOADTOKENPOOL_HXX
+
+#include "MediaHost.hxx"
+#include <QDateTime>
+#include <QList>
+#include <QMap>
+#include <QTimer>
+
+namespace eXVHP::Service {
+class MediaService;
+
+// Keeps upload identifiers (Dubz link_id, Streamff video ID, Streamja short
+// ID) fetched ahead of time so an upload can start its body transfer without
+// a round trip first. Streamable's shortcode depends on the file size, so for
+// Streamable the pool only keeps TLS connections to its hosts warm.
+class UploadTokenPool : public QObject {
+  Q_OBJECT
+
+private:
+  struct Token {
+    QString value;
+    QDateTime expiry;
+  };
+
+  struct HostPool {
+    int fetching = 0;
+    // Extra tokens held for running upload batches
+    int reserved = 0;
+    int targetSize = 0;
+    int tokenLifetime = 0;
+    QList<Token> tokens;
+    QDateTime warmExpiry;
+  };
+
+  QTimer m_expiryTimer;
+  QMap<MediaHost, HostPool> m_pools;
+  MediaService *m_service;
+  void fetch(MediaHost host);
+  void prune();
+  void refill(MediaHost host);
+  void scheduleExpiry();
+  void warm(MediaHost host);
+
+public:
+  static int defaultTokenLifetime;
+  static int retryDelay;
+
+  UploadTokenPool(MediaService *service);
+  int available(MediaHost host) const;
+  void preconnect(MediaHost host);
+  void reserve(MediaHost host, int count);
+  void setTarget(MediaHost host, int targetSize,
+                 int tokenLifetime = defaultTokenLifetime);
+  QString take(MediaHost host);
+
+signals:
+  void tokenFetchFailed(MediaHost host, const QString &error);
+};
+} // namespace eXVHP::Service
+
+#endif // EXVHP_UPLOADTOKENPOOL_HXX
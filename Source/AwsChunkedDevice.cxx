@@ -0,0 +1,128 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "AwsChunkedDevice.hxx"
+#include <QCryptographicHash>
+#include <cstring>
+
+namespace eXVHP::Service {
+// S3 rejects chunks smaller than 8 KiB other than the final one
+qint64 AwsChunkedDevice::defaultChunkSize = 0x10000;
+
+AwsChunkedDevice::AwsChunkedDevice(QIODevice *source, qint64 decodedSize,
+                                   const AwsSigV4 &signer,
+                                   const QDateTime &reqTime,
+                                   const QByteArray &seedSignature,
+                                   qint64 chunkSize, QObject *parent)
+    : ReadOnlyDevice(parent), m_chunkOffset(0), m_chunkSize(chunkSize),
+      m_decodedRead(0), m_decodedSize(decodedSize), m_finalChunkRead(false),
+      m_previousSignature(seedSignature), m_reqTime(reqTime),
+      m_seedSignature(seedSignature), m_signer(signer),
+      m_signingKey(signer.signingKey(reqTime.date())), m_source(source) {}
+
+qint64 AwsChunkedDevice::encodedSize(qint64 decodedSize, qint64 chunkSize) {
+  // <hex-size>;chunk-signature=<64 hex>\r\n<data>\r\n
+  auto frameSize = [](qint64 dataSize) {
+    return QByteArray::number(dataSize, 16).size() + 17 + 64 + 2 + dataSize +
+           2;
+  };
+
+  qint64 fullChunks = decodedSize / chunkSize;
+  qint64 lastChunkSize = decodedSize % chunkSize;
+  qint64 totalSize = fullChunks * frameSize(chunkSize) + frameSize(0);
+
+  if (lastChunkSize > 0)
+    totalSize += frameSize(lastChunkSize);
+
+  return totalSize;
+}
+
+bool AwsChunkedDevice::nextChunk() {
+  qint64 payloadSize = qMin(m_chunkSize, m_decodedSize - m_decodedRead);
+  QByteArray payload(payloadSize, Qt::Uninitialized);
+  qint64 payloadRead = 0;
+
+  while (payloadRead < payloadSize) {
+    qint64 bytesRead = m_source->read(payload.data() + payloadRead,
+                                      payloadSize - payloadRead);
+
+    if (bytesRead <= 0) {
+      setErrorString("Source device ended before the declared payload size!");
+      return false;
+    }
+
+    payloadRead += bytesRead;
+  }
+
+  QByteArray signature = m_signer.chunkSignature(
+      m_signingKey, m_reqTime, m_previousSignature,
+      QCryptographicHash::hash(payload, QCryptographicHash::Sha256).toHex());
+
+  m_chunk = QByteArray::number(payloadSize, 16) + ";chunk-signature=" +
+            signature + "\r\n" + payload + "\r\n";
+  m_chunkOffset = 0;
+  m_decodedRead += payloadSize;
+  m_finalChunkRead = payloadSize == 0;
+  m_previousSignature = signature;
+  return true;
+}
+
+qint64 AwsChunkedDevice::readData(char *data, qint64 maxSize) {
+  qint64 bytesRead = 0;
+
+  while (bytesRead < maxSize) {
+    if (m_chunkOffset == m_chunk.size()) {
+      if (m_finalChunkRead)
+        break;
+
+      if (!nextChunk())
+        return bytesRead > 0 ? bytesRead : -1;
+    }
+
+    qint64 copySize = qMin(maxSize - bytesRead, m_chunk.size() - m_chunkOffset);
+    std::memcpy(data + bytesRead, m_chunk.constData() + m_chunkOffset,
+                copySize);
+    m_chunkOffset += copySize;
+    bytesRead += copySize;
+  }
+
+  return bytesRead;
+}
+
+bool AwsChunkedDevice::isSequential() const { return false; }
+
+// Chunk signatures are chained, so only rewinding to the start (which Qt
+// does when it has to resend a request body) is supported.
+bool AwsChunkedDevice::seek(qint64 pos) {
+  if (pos == this->pos())
+    return QIODevice::seek(pos);
+
+  if (pos != 0 || !m_source->seek(0))
+    return false;
+
+  m_chunk.clear();
+  m_chunkOffset = 0;
+  m_decodedRead = 0;
+  m_finalChunkRead = false;
+  m_previousSignature = m_seedSignature;
+  return QIODevice::seek(0);
+}
+
+qint64 AwsChunkedDevice::size() const {
+  return encodedSize(m_decodedSize, m_chunkSize);
+}
+} // namespace eXVHP::Service
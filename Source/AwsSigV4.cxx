@@ -0,0 +1,263 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "AwsSigV4.hxx"
+#include <QCryptographicHash>
+#include <QMessageAuthenticationCode>
+#include <QUrlQuery>
+#include <algorithm>
+
+namespace eXVHP::Service {
+QByteArray AwsSigV4::emptyPayloadHash =
+    "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855";
+QHash<QByteArray, QByteArray> AwsSigV4::keyCache;
+QMutex AwsSigV4::keyCacheMutex;
+int AwsSigV4::keyCacheSize = 256;
+QByteArray AwsSigV4::streamingPayload = "STREAMING-AWS4-HMAC-SHA256-PAYLOAD";
+QByteArray AwsSigV4::unsignedPayload = "UNSIGNED-PAYLOAD";
+
+// Sorted, percent-encoded query string; S3 sorts by encoded key and then by
+// value, so repeated keys stay in a stable order
+QByteArray AwsSigV4::canonicalQuery(const QUrl &url) {
+  if (!url.hasQuery())
+    return QByteArray();
+
+  QList<QPair<QByteArray, QByteArray>> queryItems;
+
+  for (auto &&queryItem :
+       QUrlQuery(url).queryItems(QUrl::FullyDecoded))
+    queryItems.append(qMakePair(QUrl::toPercentEncoding(queryItem.first),
+                                QUrl::toPercentEncoding(queryItem.second)));
+
+  std::sort(queryItems.begin(), queryItems.end());
+
+  QByteArray query;
+
+  for (auto &&queryItem : queryItems) {
+    if (!query.isEmpty())
+      query += '&';
+
+    query += queryItem.first;
+    query += '=';
+    query += queryItem.second;
+  }
+
+  return query;
+}
+
+void AwsSigV4::clearKeyCache() {
+  QMutexLocker locker(&keyCacheMutex);
+  keyCache.clear();
+}
+
+QByteArray AwsSigV4::hmacSha256(const QByteArray &key,
+                                const QByteArray &data) {
+  return QMessageAuthenticationCode::hash(data, key,
+                                          QCryptographicHash::Sha256);
+}
+
+AwsSigV4::AwsSigV4(const QString &accessKeyId, const QString &secretAccessKey,
+                   const QString &region, const QString &service)
+    : m_accessKeyId(accessKeyId),
+      m_region(region.isEmpty() ? "us-east-1" : region),
+      m_secretAccessKey(secretAccessKey), m_service(service) {}
+
+QByteArray AwsSigV4::chunkSignature(const QByteArray &signingKey,
+                                    const QDateTime &reqTime,
+                                    const QByteArray &previousSignature,
+                                    const QByteArray &chunkHash) const {
+  QByteArray strToSign;
+  strToSign.reserve(320);
+  strToSign += "AWS4-HMAC-SHA256-PAYLOAD\n";
+  strToSign += reqTime.toString("yyyyMMddTHHmmssZ").toUtf8();
+  strToSign += '\n';
+  strToSign += scope(reqTime.date()).toUtf8();
+  strToSign += '\n';
+  strToSign += previousSignature;
+  strToSign += '\n';
+  strToSign += emptyPayloadHash;
+  strToSign += '\n';
+  strToSign += chunkHash;
+  return hmacSha256(signingKey, strToSign).toHex();
+}
+
+// The query of the returned URL is the canonical query itself, so values
+// such as session tokens keep the exact encoding that was signed
+QUrl AwsSigV4::presign(const QUrl &url, const QByteArray &method, int expires,
+                       const QString &sessionToken,
+                       const QDateTime &reqTime) const {
+  QByteArray amzDate = reqTime.toString("yyyyMMddTHHmmssZ").toUtf8();
+  QByteArray reqScope = scope(reqTime.date()).toUtf8();
+
+  QUrlQuery presignedQuery(url);
+  presignedQuery.addQueryItem("X-Amz-Algorithm", "AWS4-HMAC-SHA256");
+  presignedQuery.addQueryItem("X-Amz-Credential",
+                              m_accessKeyId + "/" +
+                                  QString::fromLatin1(reqScope));
+  presignedQuery.addQueryItem("X-Amz-Date", QString::fromLatin1(amzDate));
+  presignedQuery.addQueryItem("X-Amz-Expires", QString::number(expires));
+  presignedQuery.addQueryItem("X-Amz-SignedHeaders", "host");
+
+  if (!sessionToken.isEmpty())
+    presignedQuery.addQueryItem("X-Amz-Security-Token", sessionToken);
+
+  QUrl presignedUrl = url;
+  presignedUrl.setQuery(presignedQuery);
+  QByteArray query = canonicalQuery(presignedUrl);
+
+  QByteArray canonicalRequest;
+  canonicalRequest.reserve(512);
+  canonicalRequest += method;
+  canonicalRequest += '\n';
+  canonicalRequest += url.path(QUrl::FullyEncoded).toUtf8();
+  canonicalRequest += '\n';
+  canonicalRequest += query;
+  canonicalRequest += "\nhost:";
+  canonicalRequest += url.authority().toUtf8();
+  canonicalRequest += "\n\nhost\n";
+  canonicalRequest += unsignedPayload;
+
+  query += "&X-Amz-Signature=";
+  query += signature(canonicalRequest, amzDate, reqScope, reqTime.date());
+  presignedUrl.setQuery(QString::fromLatin1(query));
+  return presignedUrl;
+}
+
+QString AwsSigV4::scope(const QDate &date) const {
+  return date.toString("yyyyMMdd") + "/" + m_region + "/" + m_service +
+         "/aws4_request";
+}
+
+// Content-Length is only signed when it was set before signing, as it is
+// for aws-chunked bodies whose encoded size is known up front
+QByteArray AwsSigV4::sign(QNetworkRequest &request, const QByteArray &method,
+                          const QByteArray &payloadHash,
+                          const QDateTime &reqTime) const {
+  QByteArray amzDate = reqTime.toString("yyyyMMddTHHmmssZ").toUtf8();
+
+  if (m_service == "s3")
+    request.setRawHeader("x-amz-content-sha256", payloadHash);
+
+  request.setRawHeader("x-amz-date", amzDate);
+
+  QList<QPair<QByteArray, QByteArray>> canonicalHeaders;
+  bool hasHost = false;
+
+  for (auto &&hKey : request.rawHeaderList()) {
+    QByteArray hKeyLower = hKey.toLower();
+
+    if (hKeyLower == "content-encoding" || hKeyLower == "content-length" ||
+        hKeyLower == "content-type" || hKeyLower == "host" ||
+        hKeyLower.startsWith("x-amz-")) {
+      hasHost = hasHost || hKeyLower == "host";
+      canonicalHeaders.append(
+          qMakePair(hKeyLower, request.rawHeader(hKey).trimmed()));
+    }
+  }
+
+  if (!hasHost)
+    canonicalHeaders.append(
+        qMakePair(QByteArray("host"), request.url().authority().toUtf8()));
+
+  std::sort(canonicalHeaders.begin(), canonicalHeaders.end());
+
+  QByteArray signedHeaders;
+  QByteArray canonicalRequest;
+  canonicalRequest.reserve(1024);
+  canonicalRequest += method;
+  canonicalRequest += '\n';
+  canonicalRequest += request.url().path(QUrl::FullyEncoded).toUtf8();
+  canonicalRequest += '\n';
+  canonicalRequest += canonicalQuery(request.url());
+  canonicalRequest += '\n';
+
+  for (auto &&canonicalHeader : canonicalHeaders) {
+    canonicalRequest += canonicalHeader.first;
+    canonicalRequest += ':';
+    canonicalRequest += canonicalHeader.second;
+    canonicalRequest += '\n';
+
+    if (!signedHeaders.isEmpty())
+      signedHeaders += ';';
+
+    signedHeaders += canonicalHeader.first;
+  }
+
+  canonicalRequest += '\n';
+  canonicalRequest += signedHeaders;
+  canonicalRequest += '\n';
+  canonicalRequest += payloadHash;
+
+  QByteArray reqScope = scope(reqTime.date()).toUtf8();
+  QByteArray reqSignature =
+      signature(canonicalRequest, amzDate, reqScope, reqTime.date());
+  request.setRawHeader("Authorization",
+                       "AWS4-HMAC-SHA256 Credential=" +
+                           m_accessKeyId.toUtf8() + "/" + reqScope +
+                           ",SignedHeaders=" + signedHeaders +
+                           ",Signature=" + reqSignature);
+  return reqSignature;
+}
+
+QByteArray AwsSigV4::signature(const QByteArray &canonicalRequest,
+                               const QByteArray &amzDate,
+                               const QByteArray &reqScope,
+                               const QDate &date) const {
+  QByteArray strToSign;
+  strToSign.reserve(160);
+  strToSign += "AWS4-HMAC-SHA256\n";
+  strToSign += amzDate;
+  strToSign += '\n';
+  strToSign += reqScope;
+  strToSign += '\n';
+  strToSign += QCryptographicHash::hash(canonicalRequest,
+                                        QCryptographicHash::Sha256)
+                   .toHex();
+  return hmacSha256(signingKey(date), strToSign).toHex();
+}
+
+// The cache is dropped whole once full; entries are only good for a day, so
+// a full cache is mostly stale anyway
+QByteArray AwsSigV4::signingKey(const QDate &date) const {
+  QByteArray dateStamp = date.toString("yyyyMMdd").toUtf8();
+  QByteArray cacheKey = m_accessKeyId.toUtf8() + '/' + dateStamp + '/' +
+                        m_region.toUtf8() + '/' + m_service.toUtf8();
+
+  {
+    QMutexLocker locker(&keyCacheMutex);
+    auto cachedKey = keyCache.constFind(cacheKey);
+
+    if (cachedKey != keyCache.constEnd())
+      return cachedKey.value();
+  }
+
+  QByteArray dateKey =
+      hmacSha256(("AWS4" + m_secretAccessKey).toUtf8(), dateStamp);
+  QByteArray dateRegionKey = hmacSha256(dateKey, m_region.toUtf8());
+  QByteArray dateRegionServiceKey =
+      hmacSha256(dateRegionKey, m_service.toUtf8());
+  QByteArray derivedKey = hmacSha256(dateRegionServiceKey, "aws4_request");
+
+  QMutexLocker locker(&keyCacheMutex);
+
+  if (keyCache.size() >= keyCacheSize)
+    keyCache.clear();
+
+  keyCache.insert(cacheKey, derivedKey);
+  return derivedKey;
+}
+} // namespace eXVHP::Service
@@ -0,0 +1,69 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "DubzLinkIdScanner.hxx"
+
+namespace eXVHP::Service {
+QByteArray DubzLinkIdScanner::inputPrefix =
+    "<input type=\"hidden\" name=\"link_id\" id=\"link_id\" value=\"";
+QByteArrayMatcher DubzLinkIdScanner::inputMatcher(inputPrefix);
+qsizetype DubzLinkIdScanner::maxLinkIdSize = 256;
+
+DubzLinkIdScanner::DubzLinkIdScanner() : m_found(false), m_inValue(false) {}
+
+// Returns true once the whole value has been seen, after which further data
+// is ignored
+bool DubzLinkIdScanner::feed(const QByteArray &data) {
+  if (m_found)
+    return true;
+
+  QByteArray buffer = m_carry + data;
+  qsizetype valuePos = 0;
+  m_carry.clear();
+
+  if (!m_inValue) {
+    qsizetype prefixPos = inputMatcher.indexIn(buffer);
+
+    if (prefixPos < 0) {
+      m_carry = buffer.right(inputPrefix.size() - 1);
+      return false;
+    }
+
+    m_inValue = true;
+    valuePos = prefixPos + inputPrefix.size();
+  }
+
+  qsizetype quotePos = buffer.indexOf('"', valuePos);
+  m_linkId += buffer.mid(valuePos, quotePos < 0 ? -1 : quotePos - valuePos);
+
+  // Not a link ID after all, look for the next input
+  if (m_linkId.size() > maxLinkIdSize) {
+    m_inValue = false;
+    m_linkId.clear();
+    return false;
+  }
+
+  m_found = quotePos >= 0;
+  return m_found;
+}
+
+bool DubzLinkIdScanner::isFound() const { return m_found; }
+
+QString DubzLinkIdScanner::linkId() const {
+  return m_found ? QString::fromUtf8(m_linkId) : QString();
+}
+} // namespace eXVHP::Service
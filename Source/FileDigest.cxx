@@ -0,0 +1,119 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "FileDigest.hxx"
+#include <QCryptographicHash>
+#include <QFile>
+#include <QtConcurrent>
+
+namespace eXVHP::Service {
+FileHashCache FileDigest::cache;
+qint64 FileDigest::readChunkSize = 0x100000;
+
+QByteArray FileDigest::cachedDigest(const QString &fileName) {
+  return cache.digest(FileHashCache::fileKey(fileName));
+}
+
+// A file that changed while it was hashed is not cached
+QByteArray FileDigest::cachedSha256(const QString &fileName,
+                                    std::function<QByteArray()> hash) {
+  QByteArray fileKey = FileHashCache::fileKey(fileName);
+  QByteArray digest = cache.digest(fileKey);
+
+  if (!digest.isEmpty())
+    return digest;
+
+  digest = hash();
+
+  if (!digest.isEmpty() && FileHashCache::fileKey(fileName) == fileKey)
+    cache.insert(fileKey, digest);
+
+  return digest;
+}
+
+QByteArray FileDigest::hashFile(const QString &fileName, qint64 offset,
+                                qint64 length) {
+  QFile file(fileName);
+
+  if (!file.open(QIODevice::ReadOnly) || !file.seek(offset))
+    return QByteArray();
+
+  QCryptographicHash sha256Hash(QCryptographicHash::Sha256);
+  QByteArray chunk(readChunkSize, Qt::Uninitialized);
+  qint64 bytesLeft = length < 0 ? file.size() - offset : length;
+
+  while (bytesLeft > 0) {
+    qint64 bytesRead = file.read(chunk.data(), qMin(bytesLeft, readChunkSize));
+
+    if (bytesRead <= 0)
+      return QByteArray();
+
+    sha256Hash.addData(QByteArrayView(chunk.constData(), bytesRead));
+    bytesLeft -= bytesRead;
+  }
+
+  return sha256Hash.result();
+}
+
+void FileDigest::setCachePath(const QString &cachePath, int maxEntries) {
+  if (cachePath.isEmpty()) {
+    cache.close();
+    return;
+  }
+
+  cache.open(cachePath, maxEntries);
+}
+
+QFuture<QByteArray> FileDigest::sha256(const QString &fileName,
+                                       QThreadPool *pool) {
+  return QtConcurrent::run(pool, [fileName]() {
+    return cachedSha256(fileName,
+                        [fileName]() { return hashFile(fileName, 0, -1); });
+  });
+}
+
+QFuture<QByteArray> FileDigest::sha256(QSharedPointer<MappedFile> mappedFile,
+                                       QThreadPool *pool) {
+  return QtConcurrent::run(pool, [mappedFile]() {
+    return cachedSha256(mappedFile->fileName(), [mappedFile]() {
+      QCryptographicHash sha256Hash(QCryptographicHash::Sha256);
+
+      for (qint64 offset = 0; offset < mappedFile->size();
+           offset += readChunkSize) {
+        qint64 chunkSize = qMin(readChunkSize, mappedFile->size() - offset);
+
+        // A truncated file fails the hash instead of faulting on its
+        // mapping
+        if (!mappedFile->isReadable(offset, chunkSize))
+          return QByteArray();
+
+        sha256Hash.addData(
+            QByteArrayView(mappedFile->data() + offset, chunkSize));
+      }
+
+      return sha256Hash.result();
+    });
+  });
+}
+
+QFuture<QByteArray> FileDigest::sha256(const QString &fileName, qint64 offset,
+                                       qint64 length, QThreadPool *pool) {
+  return QtConcurrent::run(pool, [fileName, length, offset]() {
+    return hashFile(fileName, offset, length);
+  });
+}
+} // namespace eXVHP::Service
@@ -0,0 +1,191 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "FileHashCache.hxx"
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+namespace eXVHP::Service {
+int FileHashCache::defaultMaxEntries = 4096;
+
+static const char cacheMagic[8] = {'e', 'X', 'V', 'H', 'P', 'F', 'H', '1'};
+
+FileHashCache::FileHashCache()
+    : m_data(nullptr), m_loaded(false), m_maxEntries(defaultMaxEntries) {}
+
+void FileHashCache::close() {
+  QMutexLocker locker(&m_mutex);
+  unload();
+  m_file.setFileName(QString());
+}
+
+QByteArray FileHashCache::digest(const QByteArray &fileKey) {
+  QMutexLocker locker(&m_mutex);
+
+  if (fileKey.isEmpty() || !load())
+    return QByteArray();
+
+  auto slot = m_slots.constFind(fileKey);
+
+  if (slot == m_slots.constEnd())
+    return QByteArray();
+
+  Record *cacheRecord = record(*slot);
+  cacheRecord->lastUsed = ++header()->clock;
+  return QByteArray(cacheRecord->digest, sizeof(cacheRecord->digest));
+}
+
+// Packs device, inode, size and modification time into a 32 byte key, or
+// returns an empty key if the file cannot be looked up. Without stat() the
+// device and inode are stood in for by a digest of the absolute path.
+QByteArray FileHashCache::fileKey(const QString &fileName) {
+  quint64 keyFields[4];
+
+#ifdef Q_OS_UNIX
+  struct stat fileStat;
+
+  if (stat(QFile::encodeName(fileName).constData(), &fileStat) != 0)
+    return QByteArray();
+
+#ifdef Q_OS_DARWIN
+  const struct timespec &modified = fileStat.st_mtimespec;
+#else
+  const struct timespec &modified = fileStat.st_mtim;
+#endif
+
+  keyFields[0] = fileStat.st_dev;
+  keyFields[1] = fileStat.st_ino;
+  keyFields[2] = fileStat.st_size;
+  keyFields[3] = quint64(modified.tv_sec) * 1000000000 + modified.tv_nsec;
+#else
+  QFileInfo fileInfo(fileName);
+
+  if (!fileInfo.exists())
+    return QByteArray();
+
+  // qHash() is seeded per process, so the path is digested instead to give
+  // the same key in every run
+  QByteArray pathDigest = QCryptographicHash::hash(
+      fileInfo.absoluteFilePath().toUtf8(), QCryptographicHash::Sha256);
+  std::memcpy(keyFields, pathDigest.constData(), 2 * sizeof(quint64));
+  keyFields[2] = fileInfo.size();
+  keyFields[3] = fileInfo.lastModified().toMSecsSinceEpoch() * 1000000;
+#endif
+
+  return QByteArray(reinterpret_cast<const char *>(keyFields),
+                    sizeof(keyFields));
+}
+
+FileHashCache::Header *FileHashCache::header() const {
+  return reinterpret_cast<Header *>(m_data);
+}
+
+void FileHashCache::insert(const QByteArray &fileKey,
+                           const QByteArray &digest) {
+  QMutexLocker locker(&m_mutex);
+
+  if (fileKey.size() != sizeof(Record::key) ||
+      digest.size() != sizeof(Record::digest) || !load())
+    return;
+
+  quint32 slot = m_slots.value(fileKey, header()->count);
+
+  // Full, so the least recently used record makes room
+  if (slot == header()->capacity) {
+    slot = 0;
+
+    for (quint32 slotIndex = 1; slotIndex < header()->capacity; slotIndex++)
+      if (record(slotIndex)->lastUsed < record(slot)->lastUsed)
+        slot = slotIndex;
+
+    m_slots.remove(QByteArray(record(slot)->key, sizeof(Record::key)));
+  }
+
+  Record *cacheRecord = record(slot);
+  std::memcpy(cacheRecord->key, fileKey.constData(), sizeof(Record::key));
+  std::memcpy(cacheRecord->digest, digest.constData(),
+              sizeof(Record::digest));
+  cacheRecord->lastUsed = ++header()->clock;
+  m_slots.insert(fileKey, slot);
+
+  if (slot == header()->count)
+    header()->count++;
+}
+
+// Maps the index on first use, starting a new one if the file is missing,
+// damaged or was made for a different number of entries
+bool FileHashCache::load() {
+  if (m_loaded)
+    return m_data != nullptr;
+
+  m_loaded = true;
+
+  if (m_file.fileName().isEmpty() || !m_file.open(QIODevice::ReadWrite))
+    return false;
+
+  qint64 indexSize = sizeof(Header) + qint64(m_maxEntries) * sizeof(Record);
+  bool reset = m_file.size() != indexSize;
+
+  if (reset && !m_file.resize(indexSize))
+    return false;
+
+  m_data = m_file.map(0, indexSize);
+
+  if (m_data == nullptr)
+    return false;
+
+  if (reset || std::memcmp(header()->magic, cacheMagic, sizeof(cacheMagic)) ||
+      header()->capacity != quint32(m_maxEntries) ||
+      header()->count > header()->capacity) {
+    std::memset(m_data, 0, indexSize);
+    std::memcpy(header()->magic, cacheMagic, sizeof(cacheMagic));
+    header()->capacity = m_maxEntries;
+  }
+
+  for (quint32 slot = 0; slot < header()->count; slot++)
+    m_slots.insert(QByteArray(record(slot)->key, sizeof(Record::key)), slot);
+
+  return true;
+}
+
+// Only records the path, the index is mapped when it is first needed. The
+// old index is dropped under the same lock, so a lookup on another thread
+// sees either the old index or the new one.
+void FileHashCache::open(const QString &path, int maxEntries) {
+  QMutexLocker locker(&m_mutex);
+  unload();
+  m_file.setFileName(path);
+  m_maxEntries = qMax(1, maxEntries);
+}
+
+FileHashCache::Record *FileHashCache::record(quint32 slot) const {
+  return reinterpret_cast<Record *>(m_data + sizeof(Header)) + slot;
+}
+
+// Called with the mutex held
+void FileHashCache::unload() {
+  m_file.close();
+  m_data = nullptr;
+  m_loaded = false;
+  m_slots.clear();
+}
+} // namespace eXVHP::Service
@@ -0,0 +1,53 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "FileRangeDevice.hxx"
+
+namespace eXVHP::Service {
+FileRangeDevice::FileRangeDevice(const QString &fileName, qint64 offset,
+                                 qint64 length, QObject *parent)
+    : ReadOnlyDevice(parent), m_file(fileName), m_length(length),
+      m_offset(offset) {}
+
+void FileRangeDevice::close() {
+  QIODevice::close();
+  m_file.close();
+}
+
+bool FileRangeDevice::openSource() {
+  if (!m_file.open(QIODevice::ReadOnly) || !m_file.seek(m_offset)) {
+    setErrorString(m_file.errorString());
+    return false;
+  }
+
+  return true;
+}
+
+qint64 FileRangeDevice::readData(char *data, qint64 maxSize) {
+  return m_file.read(data,
+                     qMin(maxSize, m_offset + m_length - m_file.pos()));
+}
+
+bool FileRangeDevice::seek(qint64 pos) {
+  if (pos < 0 || pos > m_length)
+    return false;
+
+  return QIODevice::seek(pos) && m_file.seek(m_offset + pos);
+}
+
+qint64 FileRangeDevice::size() const { return m_length; }
+} // namespace eXVHP::Service
@@ -0,0 +1,117 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "FormDataDevice.hxx"
+#include <QRandomGenerator>
+#include <cstring>
+
+namespace eXVHP::Service {
+FormDataDevice::FormDataDevice(QObject *parent)
+    : ReadOnlyDevice(parent),
+      m_boundary("boundary_.oOo._" +
+                 QByteArray::number(QRandomGenerator::global()->generate64(),
+                                    16)),
+      m_finished(false) {}
+
+void FormDataDevice::addField(const QString &name, const QByteArray &value) {
+  append("--" + m_boundary +
+         "\r\nContent-Disposition: form-data; name=\"" + name.toUtf8() +
+         "\"\r\n\r\n" + value + "\r\n");
+}
+
+void FormDataDevice::addFile(const QString &name, const QString &fileName,
+                             const QString &mimeType, QIODevice *device) {
+  append("--" + m_boundary + "\r\nContent-Type: " + mimeType.toUtf8() +
+         "\r\nContent-Disposition: form-data; name=\"" + name.toUtf8() +
+         "\"; filename=\"" + fileName.toUtf8() + "\"\r\n\r\n");
+  append(QByteArray(), device);
+  append("\r\n");
+}
+
+void FormDataDevice::append(const QByteArray &data, QIODevice *device) {
+  qint64 offset = size();
+  m_segments.append(Segment{data, device, offset,
+                            device == nullptr ? data.size() : device->size()});
+}
+
+QByteArray FormDataDevice::contentType() const {
+  return "multipart/form-data; boundary=\"" + m_boundary + "\"";
+}
+
+bool FormDataDevice::openSource() {
+  if (!m_finished) {
+    append("--" + m_boundary + "--\r\n");
+    m_finished = true;
+  }
+
+  return true;
+}
+
+qint64 FormDataDevice::readData(char *data, qint64 maxSize) {
+  qint64 readPos = pos();
+  qint64 bytesRead = 0;
+
+  for (auto &&segment : m_segments) {
+    qint64 segmentPos = readPos - segment.offset;
+
+    if (bytesRead == maxSize)
+      break;
+
+    if (segmentPos < 0 || segmentPos >= segment.size)
+      continue;
+
+    qint64 copySize = qMin(maxSize - bytesRead, segment.size - segmentPos);
+
+    if (segment.device == nullptr) {
+      std::memcpy(data + bytesRead, segment.data.constData() + segmentPos,
+                  copySize);
+    } else {
+      if (segment.device->pos() != segmentPos &&
+          !segment.device->seek(segmentPos)) {
+        setErrorString(segment.device->errorString());
+        return bytesRead > 0 ? bytesRead : -1;
+      }
+
+      copySize = segment.device->read(data + bytesRead, copySize);
+
+      if (copySize < 0) {
+        setErrorString(segment.device->errorString());
+        return bytesRead > 0 ? bytesRead : -1;
+      }
+    }
+
+    bytesRead += copySize;
+    readPos += copySize;
+  }
+
+  return bytesRead;
+}
+
+bool FormDataDevice::seek(qint64 pos) {
+  if (pos < 0 || pos > size())
+    return false;
+
+  return QIODevice::seek(pos);
+}
+
+qint64 FormDataDevice::size() const {
+  if (m_segments.isEmpty())
+    return 0;
+
+  return m_segments.last().offset + m_segments.last().size;
+}
+} // namespace eXVHP::Service
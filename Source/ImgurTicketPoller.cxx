@@ -0,0 +1,160 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ImgurTicketPoller.hxx"
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QUrlQuery>
+
+namespace eXVHP::Service {
+int ImgurTicketPoller::defaultInitialInterval = 1000;
+int ImgurTicketPoller::defaultMaxInterval = 30000;
+
+ImgurTicketPoller::ImgurTicketPoller(QNetworkAccessManager *nam,
+                                     const QString &pollUrl,
+                                     const QString &clientId, QObject *parent)
+    : QObject(parent), m_clientId(clientId), m_failedPolls(0),
+      m_http2Allowed(true),
+      m_interval(defaultInitialInterval),
+      m_initialInterval(defaultInitialInterval),
+      m_maxInterval(defaultMaxInterval), m_nam(nam), m_pollResp(nullptr),
+      m_pollUrl(pollUrl),
+      m_retryRule(RetryPolicy().rule(MediaHost::Imgur, UploadPhase::Poll)),
+      m_ticketsAdded(false) {
+  m_timer.setSingleShot(true);
+  connect(&m_timer, &QTimer::timeout, this, &ImgurTicketPoller::poll);
+}
+
+void ImgurTicketPoller::addTicket(const QString &ticket) {
+  m_tickets.insert(ticket);
+
+  // A new ticket gets its short first poll even if the batch has backed off,
+  // but a failed poll's retry backoff is kept
+  if (m_pollResp != nullptr || (m_failedPolls > 0 && m_timer.isActive()))
+    m_ticketsAdded = true;
+
+  else if (!m_timer.isActive() ||
+           m_timer.remainingTime() > m_initialInterval) {
+    m_interval = m_initialInterval;
+    m_timer.start(m_interval);
+  }
+}
+
+void ImgurTicketPoller::poll() {
+  if (m_tickets.isEmpty())
+    return;
+
+  QUrlQuery pollQuery{{"client_id", m_clientId}};
+
+  for (auto &&ticket : m_tickets)
+    pollQuery.addQueryItem("tickets[]", ticket);
+
+  QUrl reqUrl(m_pollUrl);
+  reqUrl.setQuery(pollQuery);
+  QSet<QString> polledTickets = m_tickets;
+  QNetworkRequest pollReq(reqUrl);
+  pollReq.setAttribute(QNetworkRequest::Http2AllowedAttribute, m_http2Allowed);
+  m_pollResp = m_nam->get(pollReq);
+
+  connect(m_pollResp, &QNetworkReply::finished, this,
+          [this, polledTickets, pollResp = m_pollResp]() {
+            m_pollResp = nullptr;
+            pollResp->deleteLater();
+
+            if (pollResp->error() != QNetworkReply::NoError) {
+              m_failedPolls++;
+
+              if (RetryPolicy::isTransient(pollResp) &&
+                  m_failedPolls < m_retryRule.maxAttempts) {
+                m_timer.start(RetryPolicy::backoff(m_failedPolls,
+                                                   m_retryRule.baseDelay,
+                                                   m_retryRule.maxDelay));
+                return;
+              }
+
+              m_failedPolls = 0;
+
+              for (auto &&ticket : polledTickets) {
+                if (m_tickets.remove(ticket))
+                  emit this->ticketFailed(ticket, pollResp->errorString());
+              }
+
+              schedulePoll();
+              return;
+            }
+
+            m_failedPolls = 0;
+            QJsonObject dataValue = QJsonDocument::fromJson(pollResp->readAll())
+                                        .object()["data"]
+                                        .toObject();
+
+            // Imgur sends an empty array rather than an object when no
+            // tickets are done yet
+            QJsonObject doneObject = dataValue["done"].toObject();
+            QJsonObject imagesObject = dataValue["images"].toObject();
+
+            for (auto &&ticket : polledTickets) {
+              if (!doneObject.contains(ticket) || !m_tickets.remove(ticket))
+                continue;
+
+              QString videoId = doneObject[ticket].toString();
+              emit this->ticketDone(ticket, videoId,
+                                    imagesObject[videoId]
+                                        .toObject()["deletehash"]
+                                        .toString());
+            }
+
+            schedulePoll();
+          });
+}
+
+void ImgurTicketPoller::removeTicket(const QString &ticket) {
+  m_tickets.remove(ticket);
+
+  if (m_tickets.isEmpty())
+    m_timer.stop();
+}
+
+void ImgurTicketPoller::schedulePoll() {
+  if (m_tickets.isEmpty()) {
+    m_interval = m_initialInterval;
+    return;
+  }
+
+  m_interval = m_ticketsAdded ? m_initialInterval
+                              : qMin(m_interval * 2, m_maxInterval);
+  m_ticketsAdded = false;
+  m_timer.start(m_interval);
+}
+
+void ImgurTicketPoller::setHttp2Allowed(bool http2Allowed) {
+  m_http2Allowed = http2Allowed;
+}
+
+void ImgurTicketPoller::setIntervals(int initialInterval, int maxInterval) {
+  m_initialInterval = qMax(1, initialInterval);
+  m_maxInterval = qMax(m_initialInterval, maxInterval);
+}
+
+void ImgurTicketPoller::setPollUrl(const QString &pollUrl) {
+  m_pollUrl = pollUrl;
+}
+
+void ImgurTicketPoller::setRetryRule(const RetryPolicy::Rule &retryRule) {
+  m_retryRule = retryRule;
+}
+} // namespace eXVHP::Service
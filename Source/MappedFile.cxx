@@ -0,0 +1,156 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "MappedFile.hxx"
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace eXVHP::Service {
+QHash<QPair<quint64, quint64>, int> MappedFile::openMappings;
+QMutex MappedFile::openMappingsMutex;
+
+MappedFile::MappedFile(const QString &fileName)
+    : m_data(nullptr), m_file(fileName), m_fileId(0, 0), m_releasedEnd(0),
+      m_size(0) {}
+
+// Pages still mapped are kept by posix_fadvise(), so the file is unmapped
+// before the pages released so far are dropped
+MappedFile::~MappedFile() {
+#ifdef Q_OS_LINUX
+  if (m_data == nullptr)
+    return;
+
+  QMutexLocker openMappingsLocker(&openMappingsMutex);
+
+  if (--openMappings[m_fileId] > 0)
+    return;
+
+  openMappings.remove(m_fileId);
+  m_file.unmap(const_cast<uchar *>(m_data));
+
+  if (m_releasedEnd > 0)
+    posix_fadvise(m_file.handle(), 0, m_releasedEnd, POSIX_FADV_DONTNEED);
+#endif
+}
+
+const uchar *MappedFile::data() const { return m_data; }
+
+QString MappedFile::errorString() const { return m_file.errorString(); }
+
+QString MappedFile::fileName() const { return m_file.fileName(); }
+
+// Checks the file as it is now, not the size it had when it was mapped. Safe
+// to call from any thread.
+bool MappedFile::isReadable(qint64 offset, qint64 length) const {
+  if (m_data == nullptr || offset < 0 || offset + length > m_size)
+    return false;
+
+#ifdef Q_OS_UNIX
+  struct stat fileStat;
+
+  if (fstat(m_file.handle(), &fileStat) != 0)
+    return false;
+
+  return offset + length <= qint64(fileStat.st_size);
+#else
+  // Windows refuses to truncate a file while a view of it is mapped
+  return true;
+#endif
+}
+
+bool MappedFile::open() {
+  if (m_data != nullptr)
+    return true;
+
+  if (!m_file.open(QIODevice::ReadOnly) || m_file.size() == 0)
+    return false;
+
+  m_size = m_file.size();
+  m_data = m_file.map(0, m_size);
+
+  if (m_data == nullptr)
+    return false;
+
+#ifdef Q_OS_UNIX
+  madvise(const_cast<uchar *>(m_data), m_size, MADV_SEQUENTIAL);
+#endif
+#ifdef Q_OS_LINUX
+  posix_fadvise(m_file.handle(), 0, 0, POSIX_FADV_SEQUENTIAL);
+  struct stat fileStat;
+
+  if (fstat(m_file.handle(), &fileStat) == 0)
+    m_fileId = qMakePair(quint64(fileStat.st_dev), quint64(fileStat.st_ino));
+
+  QMutexLocker openMappingsLocker(&openMappingsMutex);
+  openMappings[m_fileId]++;
+#endif
+
+  return true;
+}
+
+qint64 MappedFile::pageSize() {
+#ifdef Q_OS_UNIX
+  static qint64 pageSize = sysconf(_SC_PAGESIZE);
+  return pageSize;
+#else
+  return 0x1000;
+#endif
+}
+
+// Widened to whole pages, madvise() only takes page aligned ranges
+void MappedFile::prefetch(qint64 offset, qint64 length) {
+  qint64 start = qMax(qint64(0), offset) / pageSize() * pageSize();
+  qint64 end = qMin(size(), offset + length);
+
+  if (m_data == nullptr || end <= start)
+    return;
+
+#ifdef Q_OS_UNIX
+  madvise(const_cast<uchar *>(m_data) + start, end - start, MADV_WILLNEED);
+#endif
+#ifdef Q_OS_LINUX
+  posix_fadvise(m_file.handle(), start, end - start, POSIX_FADV_WILLNEED);
+#endif
+}
+
+// Narrowed to whole pages so pages still partly needed are kept
+void MappedFile::release(qint64 offset, qint64 length) {
+  qint64 start =
+      (qMax(qint64(0), offset) + pageSize() - 1) / pageSize() * pageSize();
+  qint64 end = qMin(size(), offset + length) / pageSize() * pageSize();
+
+  if (m_data == nullptr || end <= start)
+    return;
+
+  m_releasedEnd = qMax(m_releasedEnd, end);
+
+#ifdef Q_OS_UNIX
+  madvise(const_cast<uchar *>(m_data) + start, end - start, MADV_DONTNEED);
+#endif
+}
+
+// The mapped length once open, so a file that grows is not read past its
+// mapping
+qint64 MappedFile::size() const {
+  return m_data != nullptr ? m_size : m_file.size();
+}
+} // namespace eXVHP::Service
@@ -0,0 +1,77 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "MappedFileDevice.hxx"
+#include <cstring>
+
+namespace eXVHP::Service {
+qint64 MappedFileDevice::readAhead = 4 * 0x100000;
+
+MappedFileDevice::MappedFileDevice(QSharedPointer<MappedFile> file,
+                                   QObject *parent)
+    : ReadOnlyDevice(parent), m_file(file), m_prefetchedPos(0),
+      m_releasedPos(0) {}
+
+bool MappedFileDevice::openSource() {
+  if (!m_file->open()) {
+    setErrorString(m_file->errorString());
+    return false;
+  }
+
+  return true;
+}
+
+qint64 MappedFileDevice::readData(char *data, qint64 maxSize) {
+  qint64 readPos = pos();
+  qint64 copySize = qMin(maxSize, size() - readPos);
+
+  if (copySize <= 0)
+    return 0;
+
+  if (!m_file->isReadable(readPos, copySize)) {
+    setErrorString("File was truncated during upload!");
+    return -1;
+  }
+
+  std::memcpy(data, m_file->data() + readPos, copySize);
+  readPos += copySize;
+
+  if (readPos + readAhead / 2 > m_prefetchedPos) {
+    m_file->prefetch(readPos, readAhead);
+    m_prefetchedPos = readPos + readAhead;
+  }
+
+  if (readPos - m_releasedPos > 2 * readAhead) {
+    m_file->release(m_releasedPos, readPos - readAhead - m_releasedPos);
+    m_releasedPos = readPos - readAhead;
+  }
+
+  return copySize;
+}
+
+// A request resent from the start pages the released range back in
+bool MappedFileDevice::seek(qint64 pos) {
+  if (pos < 0 || pos > size() || !QIODevice::seek(pos))
+    return false;
+
+  m_prefetchedPos = pos;
+  m_releasedPos = qMin(m_releasedPos, pos);
+  return true;
+}
+
+qint64 MappedFileDevice::size() const { return m_file->size(); }
+} // namespace eXVHP::Service
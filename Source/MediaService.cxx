@@ -15,700 +15,2108 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include "AwsChunkedDevice.hxx"
+#include "FileDigest.hxx"
+#include "FormDataDevice.hxx"
+#include "ImgurTicketPoller.hxx"
+#include "MappedFileDevice.hxx"
+#include "RateLimitedDevice.hxx"
+#include "S3MultipartUpload.hxx"
 #include "Service.hxx"
+#include "SharedFileDevice.hxx"
+#include "UploadPreflight.hxx"
+#include "UploadTokenPool.hxx"
 #include <QFileInfo>
-#include <QHttpMultiPart>
+#include <QFutureWatcher>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
-#include <QMessageAuthenticationCode>
-#include <QMimeDatabase>
 #include <QNetworkReply>
-#include <QTimer>
+#include <QSet>
+#include <QSslConfiguration>
 #include <QUrlQuery>
 
 namespace eXVHP::Service {
-QString MediaService::dubzUrl = "https://dubz.co";
-QString MediaService::imgurApiUrl = "https://api.imgur.com";
-QString MediaService::imgurBaseUrl = "https://imgur.com";
 QString MediaService::imgurClientId = "546c25a59c58ad7";
-QString MediaService::jslApiUrl = "https://api.juststream.live";
-QString MediaService::jslBaseUrl = "https://juststream.live";
-QString MediaService::sabApiUrl = "https://ajax.streamable.com";
-QString MediaService::sabAwsUrl = "https://streamables-upload.s3.amazonaws.com";
-QString MediaService::sabBaseUrl = "https://streamable.com";
 QString MediaService::sabReactVersion =
     "03db98af3545197e67cb96893d9e9d8729eee743";
-QString MediaService::sffBaseUrl = "https://streamff.com";
-QString MediaService::sjaBaseUrl = "https://streamja.com";
-QRegularExpression MediaService::dubzlinkIdRegex(
-    "<input type=\"hidden\" name=\"link_id\" "
-    "id=\"link_id\" value=\"(?<linkId>[^\"]*)\" />");
 
-QString MediaService::dubzParseLinkId(const QString &homePageData) {
-  QRegularExpressionMatch linkIdRegexMatch =
-      dubzlinkIdRegex.match(homePageData);
+// Form with the job's file as its file part. The file stays with the job
+// rather than the form, so a body that fails can be sent again.
+FormDataDevice *MediaService::bodyForm(UploadJob *job,
+                                       const QString &fieldName) {
+  FormDataDevice *uploadForm = new FormDataDevice();
+  QIODevice *body = openBody(job);
 
-  return linkIdRegexMatch.hasMatch() ? linkIdRegexMatch.captured("linkId")
-                                     : QString();
+  if (body != job->videoFile)
+    body->setParent(uploadForm);
+
+  uploadForm->addFile(fieldName, job->videoFileName, job->videoMimeType, body);
+  return uploadForm;
 }
 
-MediaService::MediaService(QNetworkAccessManager *nam, QObject *parent)
-    : QObject(parent) {
-  if (nam == nullptr)
-    nam = new QNetworkAccessManager(this);
+// A file whose digest is already known from the hash cache is answered
+// without reading it. Otherwise the upload starts right away and the file is
+// hashed alongside it: a hit stops whatever phase is running and reports the
+// cached result, a miss keeps the digest for the cache entry and Streamable's
+// payload hash.
+bool MediaService::cacheLookup(UploadJob *job) {
+  QFile *videoFile = job->videoFile;
 
-  m_nam = nam;
+  if (!m_cache.isOpen())
+    return false;
+
+  QByteArray digest = FileDigest::cachedDigest(videoFile->fileName());
+
+  if (!digest.isEmpty()) {
+    QString cacheKey = UploadCache::entryKey(job->host, digest);
+    QJsonObject cacheEntry = m_cache.entry(cacheKey);
+
+    if (!cacheEntry.isEmpty()) {
+      emit this->mediaUploaded(videoFile, cacheEntry["videoId"].toString(),
+                               cacheEntry["videoLink"].toString());
+      videoFile->deleteLater();
+      return true;
+    }
+
+    m_cacheKeys.insert(videoFile, cacheKey);
+    m_contentDigests.insert(videoFile, digest);
+    return false;
+  }
+
+  if (!job->payloadHash.isValid())
+    job->payloadHash = payloadHash(videoFile);
+
+  MediaHost host = job->host;
+  m_cacheDigests.insert(videoFile, job->payloadHash);
+  QFutureWatcher<QByteArray> *digestWatcher =
+      new QFutureWatcher<QByteArray>(this);
+  connect(digestWatcher, &QFutureWatcher<QByteArray>::finished, this,
+          [this, digestWatcher, host, videoFile]() {
+            m_uploadTasks.remove(videoFile, digestWatcher);
+            digestWatcher->deleteLater();
+
+            // The upload already reported its result
+            if (!m_cacheDigests.contains(videoFile))
+              return;
+
+            m_cacheDigests.remove(videoFile);
+            QByteArray digest = digestWatcher->result();
+
+            if (digest.isEmpty())
+              return;
+
+            QString cacheKey = UploadCache::entryKey(host, digest);
+            QJsonObject cacheEntry = m_cache.entry(cacheKey);
+
+            if (cacheEntry.isEmpty()) {
+              m_cacheKeys.insert(videoFile, cacheKey);
+              m_contentDigests.insert(videoFile, digest);
+              return;
+            }
+
+            stopTasks(videoFile);
+            emit this->mediaUploaded(videoFile,
+                                     cacheEntry["videoId"].toString(),
+                                     cacheEntry["videoLink"].toString());
+            videoFile->deleteLater();
+          });
+  trackTask(videoFile, digestWatcher);
+  digestWatcher->setFuture(job->payloadHash);
+  return false;
 }
 
-void MediaService::uploadDubz(QFile *videoFile, const QString &videoTitle) {
-  QString videoFileName = QFileInfo(*videoFile).fileName();
-  QString videoMimeType = QMimeDatabase().mimeTypeForFile(videoFileName).name();
+// Reports exactly one error for the canceled upload. A fan-out host that
+// was not started yet is only released.
+void MediaService::cancel(QFile *videoFile) {
+  auto handle = m_fanOutHandles.constFind(videoFile);
+
+  if (handle != m_fanOutHandles.constEnd() && !handle->started) {
+    fanOutError(videoFile, "Upload canceled!");
+    return;
+  }
+
+  UploadJob *job = m_jobs.value(videoFile);
+
+  if (job != nullptr)
+    job->status = UploadJob::Status::Canceling;
+
+  if (m_journalKeys.contains(videoFile))
+    m_journal.removeJob(m_journalKeys.take(videoFile));
+
+  QList<QFile *> hostFiles;
+
+  for (auto it = m_fanOutHandles.cbegin(); it != m_fanOutHandles.cend(); ++it)
+    if (it->videoFile == videoFile)
+      hostFiles.append(it.key());
+
+  // The original reports the cancel itself, ahead of its hosts, unless a
+  // race already reported its winner
+  if (!hostFiles.isEmpty()) {
+    auto race = m_races.find(videoFile);
+
+    if (race != m_races.end())
+      race->canceled = true;
+
+    if (race == m_races.end() || !race->won)
+      emit this->mediaUploadError(videoFile, "Upload canceled!");
+
+    for (auto &&hostFile : hostFiles)
+      cancel(hostFile);
 
-  if (videoMimeType != "video/mp4") {
-    emit this->mediaUploadError(
-        videoFile, "Unsupported file type! Dubz only supports MP4!");
     return;
   }
 
-  QNetworkReply *homePageResp = m_nam->get(QNetworkRequest(QUrl(dubzUrl)));
+  if (stopTasks(videoFile) || job != nullptr)
+    emit this->mediaUploadError(videoFile, "Upload canceled!");
+}
+
+void MediaService::dubzUploadVideo(UploadJob *job) {
+  QFile *videoFile = job->videoFile;
+  journalRecord(videoFile, MediaHost::Dubz,
+                QJsonObject{{"phase", "body"}, {"token", job->token}});
+
+  FormDataDevice *uploadForm = bodyForm(job, "upload_file");
+  uploadForm->addField("link_id", job->token.toUtf8());
+
+  QNetworkReply *uploadResp =
+      postForm(MediaHost::Dubz, request(QUrl(m_dubzUrl + "/upload_file.php")),
+               uploadForm);
+  trackTask(videoFile, uploadResp);
+  traceReply(videoFile, MediaHost::Dubz, UploadPhase::Body, uploadResp);
+
+  connect(uploadResp, &QNetworkReply::uploadProgress, this,
+          [this, videoFile](qint64 bytesSent, qint64 bytesTotal) {
+            reportProgress(videoFile, bytesSent, bytesTotal);
+          });
+  connect(uploadResp, &QNetworkReply::finished, this,
+          [this, jobId = job->id, uploadResp, videoFile]() {
+            UploadJob *job = liveJob(videoFile, jobId);
+
+            if (job == nullptr)
+              return;
+
+            if (uploadResp->error() != QNetworkReply::NoError) {
+              if (retryPhase(job, uploadResp,
+                             [this, job]() { dubzUploadVideo(job); }))
+                return;
 
-  connect(homePageResp, &QNetworkReply::finished, this,
-          [this, homePageResp, videoFile, videoFileName, videoMimeType]() {
-            if (homePageResp->error() != QNetworkReply::NoError) {
               emit this->mediaUploadError(videoFile,
-                                          homePageResp->errorString());
+                                          uploadResp->errorString());
               return;
             }
 
-            QString linkId = dubzParseLinkId(QString(homePageResp->readAll()));
-
-            QHttpMultiPart *uploadMultiPart =
-                new QHttpMultiPart(QHttpMultiPart::FormDataType);
-
-            QHttpPart videoFilePart;
-            videoFilePart.setHeader(QNetworkRequest::ContentTypeHeader,
-                                    QVariant(videoMimeType));
-            videoFilePart.setHeader(
-                QNetworkRequest::ContentDispositionHeader,
-                QVariant("form-data; name=\"upload_file\"; filename=\"" +
-                         videoFileName + "\""));
-            videoFile->open(QIODevice::ReadOnly);
-            videoFilePart.setBodyDevice(videoFile);
-            videoFile->setParent(uploadMultiPart);
-            uploadMultiPart->append(videoFilePart);
-
-            QHttpPart linkIdPart;
-            linkIdPart.setHeader(QNetworkRequest::ContentDispositionHeader,
-                                 QVariant("form-data; name=\"link_id\""));
-            linkIdPart.setBody(linkId.toUtf8());
-            uploadMultiPart->append(linkIdPart);
-
-            QNetworkReply *uploadResp =
-                m_nam->post(QNetworkRequest(QUrl(dubzUrl + "/upload_file.php")),
-                            uploadMultiPart);
-
-            connect(uploadResp, &QNetworkReply::uploadProgress, this,
-                    [this, videoFile](qint64 bytesSent, qint64 bytesTotal) {
-                      emit this->mediaUploadProgress(videoFile, bytesSent,
-                                                     bytesTotal);
-                    });
-            connect(uploadResp, &QNetworkReply::finished, this,
-                    [this, linkId, uploadResp, videoFile]() {
-                      if (uploadResp->error() != QNetworkReply::NoError) {
-                        emit this->mediaUploadError(videoFile,
-                                                    uploadResp->errorString());
-                        return;
-                      }
-
-                      emit this->mediaUploaded(videoFile, linkId,
-                                               dubzUrl + "/v/" + linkId);
-                    });
-            connect(uploadResp, &QNetworkReply::finished, uploadMultiPart,
-                    &QHttpMultiPart::deleteLater);
-            connect(uploadResp, &QNetworkReply::finished, uploadResp,
-                    &QNetworkReply::deleteLater);
-          });
-  connect(homePageResp, &QNetworkReply::finished, homePageResp,
+            // The job is released while the signal is delivered
+            QString linkId = job->token;
+            emit this->mediaUploaded(videoFile, linkId,
+                                     m_dubzUrl + "/v/" + linkId);
+          });
+  connect(uploadResp, &QNetworkReply::finished, uploadResp,
           &QNetworkReply::deleteLater);
 }
 
-void MediaService::uploadImgur(QFile *videoFile, const QString &videoTitle) {
-  QString videoFileName = QFileInfo(*videoFile).fileName();
-  QString videoMimeType = QMimeDatabase().mimeTypeForFile(videoFileName).name();
+void MediaService::fanOutError(QFile *hostFile, const QString &error) {
+  if (!m_fanOutHandles.contains(hostFile))
+    return;
+
+  FanOutHandle handle = m_fanOutHandles.value(hostFile);
+
+  emit this->hostMediaUploadError(handle.host, handle.videoFile, error);
+  auto race = m_races.find(handle.videoFile);
+
+  // Hosts still running once the race is won were canceled, so their time
+  // says nothing about the host
+  if (race != m_races.end())
+    race->hostElapsed.insert(handle.host,
+                             race->won ? -1 : race->timer.elapsed());
+
+  fanOutRelease(hostFile);
+}
 
-  if (!QStringList{"video/mp4", "video/x-matroska"}.contains(videoMimeType)) {
-    emit this->mediaUploadError(
-        videoFile, "Unsupported file type! Imgur accepts MKV/MP4!");
+void MediaService::fanOutProgress(QFile *hostFile, qint64 bytesSent,
+                                  qint64 bytesTotal) {
+  if (!m_fanOutHandles.contains(hostFile))
     return;
+
+  FanOutHandle handle = m_fanOutHandles.value(hostFile);
+
+  emit this->hostMediaUploadProgress(handle.host, handle.videoFile,
+                                     bytesSent, bytesTotal);
+}
+
+void MediaService::fanOutRelease(QFile *hostFile) {
+  if (!m_fanOutHandles.contains(hostFile))
+    return;
+
+  FanOutHandle handle = m_fanOutHandles.take(hostFile);
+  handle.reader->removeConsumer(hostFile);
+
+  for (auto &&otherHandle : m_fanOutHandles)
+    if (otherHandle.videoFile == handle.videoFile)
+      return;
+
+  if (m_races.contains(handle.videoFile)) {
+    Race race = m_races.take(handle.videoFile);
+
+    if (!race.won && !race.canceled)
+      emit this->mediaUploadError(handle.videoFile,
+                                  "Upload failed on every host!");
+
+    emit this->raceFinished(handle.videoFile, race.won, race.winner,
+                            race.hostElapsed);
   }
 
-  if (videoFile->size() > 50 * 0x100000) {
-    emit this->mediaUploadError(videoFile,
-                                "File too big! Imgur supports 200MB maximum!");
+  emit this->fanOutFinished(handle.videoFile);
+  handle.videoFile->deleteLater();
+}
+
+void MediaService::fanOutUploaded(QFile *hostFile, const QString &videoId,
+                                  const QString &videoLink) {
+  if (!m_fanOutHandles.contains(hostFile))
     return;
+
+  FanOutHandle handle = m_fanOutHandles.value(hostFile);
+
+  emit this->hostMediaUploaded(handle.host, handle.videoFile, videoId,
+                               videoLink);
+  auto race = m_races.find(handle.videoFile);
+
+  if (race != m_races.end()) {
+    race->hostElapsed.insert(handle.host, race->timer.elapsed());
+
+    if (!race->won) {
+      race->won = true;
+      race->winner = handle.host;
+      emit this->mediaUploaded(handle.videoFile, videoId, videoLink);
+
+      // Stop the other hosts to give their bandwidth back
+      QList<QFile *> loserFiles;
+
+      for (auto it = m_fanOutHandles.cbegin(); it != m_fanOutHandles.cend();
+           ++it)
+        if (it->videoFile == handle.videoFile && it.key() != hostFile)
+          loserFiles.append(it.key());
+
+      for (auto &&loserFile : loserFiles)
+        cancel(loserFile);
+    }
+  }
+
+  fanOutRelease(hostFile);
+}
+
+QStringList MediaService::hostUrls(MediaHost host) const {
+  switch (host) {
+  case MediaHost::Dubz:
+    return {m_dubzUrl};
+
+  case MediaHost::Imgur:
+    return {m_imgurApiUrl, m_imgurBaseUrl};
+
+  case MediaHost::JustStreamLive:
+    return {m_jslApiUrl};
+
+  case MediaHost::Streamable:
+    return {m_sabApiUrl, m_sabAwsUrl};
+
+  case MediaHost::Streamff:
+    return {m_sffBaseUrl};
+
+  case MediaHost::Streamja:
+    return {m_sjaBaseUrl};
+
+  default:
+    return {};
   }
+}
+
+MediaService::MediaService(QNetworkAccessManager *nam, QObject *parent)
+    : QObject(parent), m_dubzUrl("https://dubz.co"),
+      m_imgurApiUrl("https://api.imgur.com"),
+      m_imgurBaseUrl("https://imgur.com"), m_http2Allowed(true),
+      m_jslApiUrl("https://api.juststream.live"),
+      m_jslBaseUrl("https://juststream.live"), m_progressRing(nullptr),
+      m_sabApiUrl("https://ajax.streamable.com"),
+      m_sabAwsUrl("https://streamables-upload.s3.amazonaws.com"),
+      m_sabBaseUrl("https://streamable.com"),
+      m_sabMaxConcurrentParts(S3MultipartUpload::defaultMaxConcurrentParts),
+      m_sabMaxPartRetries(S3MultipartUpload::defaultMaxPartRetries),
+      m_sabPartSize(S3MultipartUpload::defaultPartSize),
+      m_sffBaseUrl("https://streamff.com"),
+      m_sjaBaseUrl("https://streamja.com"),
+      m_streamableUploadMode(StreamableUploadMode::SignedPayload) {
+  if (nam == nullptr)
+    nam = new QNetworkAccessManager(this);
+
+  m_nam = nam;
+  m_imgurPoller = new ImgurTicketPoller(m_nam, m_imgurBaseUrl + "/upload/poll",
+                                        imgurClientId, this);
+  connect(m_imgurPoller, &ImgurTicketPoller::ticketDone, this,
+          &MediaService::imgurTicketDone);
+  connect(m_imgurPoller, &ImgurTicketPoller::ticketFailed, this,
+          &MediaService::imgurTicketFailed);
+  m_imgurPoller->setRetryRule(
+      m_retryPolicy.rule(MediaHost::Imgur, UploadPhase::Poll));
+  m_rateLimiter = new RateLimiter(this);
+  m_tokenPool = new UploadTokenPool(this);
+
+  // Fan-out uploads run through the regular upload paths with one QFile
+  // handle per host; their results are reported again per host
+  connect(this, &MediaService::mediaUploaded, this,
+          &MediaService::fanOutUploaded);
+  connect(this, &MediaService::mediaUploadError, this,
+          &MediaService::fanOutError);
+  connect(this, &MediaService::mediaUploadProgress, this,
+          &MediaService::fanOutProgress);
+  connect(this, &MediaService::mediaUploaded, this,
+          [this](QFile *videoFile) {
+            if (m_journalKeys.contains(videoFile))
+              m_journal.removeJob(m_journalKeys.take(videoFile));
+          });
+  connect(this, &MediaService::mediaUploadError, this,
+          [this](QFile *videoFile) { m_journalKeys.remove(videoFile); });
+
+  // Progress held back by the coalescing interval is sent from a timer
+  m_progressTimer.setSingleShot(true);
+  connect(&m_progressTimer, &QTimer::timeout, this,
+          &MediaService::flushProgress);
+  connect(this, &MediaService::mediaUploaded, this,
+          [this](QFile *videoFile) { m_progress.remove(videoFile); });
+  connect(this, &MediaService::mediaUploadError, this,
+          [this](QFile *videoFile) { m_progress.remove(videoFile); });
+  connect(this, &MediaService::mediaUploaded, this,
+          [this](QFile *videoFile, const QString &videoId,
+                 const QString &videoLink) {
+            m_contentDigests.remove(videoFile);
+
+            if (m_cacheKeys.contains(videoFile))
+              m_cache.insert(m_cacheKeys.take(videoFile), videoId, videoLink);
+
+            // Finished before its hash, which is cached once it is done
+            UploadJob *job = m_jobs.value(videoFile);
+
+            if (job != nullptr && m_cacheDigests.contains(videoFile))
+              m_cacheDigests.take(videoFile).then(
+                  this, [this, host = job->host, videoId,
+                         videoLink](const QByteArray &digest) {
+                    if (!digest.isEmpty() && m_cache.isOpen())
+                      m_cache.insert(UploadCache::entryKey(host, digest),
+                                     videoId, videoLink);
+                  });
+          });
+  connect(this, &MediaService::mediaUploadError, this,
+          [this](QFile *videoFile) {
+            m_cacheDigests.remove(videoFile);
+            m_cacheKeys.remove(videoFile);
+            m_contentDigests.remove(videoFile);
+          });
+
+  // Jobs go back to the pool once their upload reports a result; emitters
+  // pass copies, never references into the job
+  connect(this, &MediaService::mediaUploaded, this,
+          [this](QFile *videoFile, const QString &videoId,
+                 const QString &videoLink) {
+            UploadResult result;
+            result.uploaded = true;
+            result.videoId = videoId;
+            result.videoLink = videoLink;
+            resolveUpload(videoFile, result);
+          });
+  connect(this, &MediaService::mediaUploadError, this,
+          [this](QFile *videoFile, const QString &error) {
+            UploadResult result;
+            result.error = error;
+            resolveUpload(videoFile, result);
+          });
+  connect(this, &MediaService::mediaUploaded, this, &MediaService::finishJob);
+  connect(this, &MediaService::mediaUploadError, this,
+          &MediaService::finishJob);
+}
 
-  QUrl reqUrl(imgurApiUrl + "/3/upload/checkcaptcha");
+void MediaService::imgurCheckCaptcha(UploadJob *job) {
+  QFile *videoFile = job->videoFile;
+  QUrl reqUrl(m_imgurApiUrl + "/3/upload/checkcaptcha");
   reqUrl.setQuery("client_id=" + imgurClientId);
   auto resp = m_nam->post(
-      QNetworkRequest(reqUrl),
+      request(reqUrl),
       QJsonDocument(QJsonObject({{"g-recaptcha-response", QJsonValue()},
                                  {"total_upload", 1}}))
           .toJson(QJsonDocument::Compact));
+  trackTask(videoFile, resp);
+  traceReply(videoFile, MediaHost::Imgur, UploadPhase::Token, resp);
+  connect(resp, &QNetworkReply::finished, this,
+          [this, jobId = job->id, resp, videoFile]() {
+            UploadJob *job = liveJob(videoFile, jobId);
+
+            if (job == nullptr)
+              return;
+
+            if (resp->error() != QNetworkReply::NoError) {
+              if (retryPhase(job, resp,
+                             [this, job]() { imgurCheckCaptcha(job); }))
+                return;
+
+              emit this->mediaUploadError(videoFile, resp->errorString());
+              return;
+            }
+
+            imgurUploadVideo(job);
+          });
+  connect(resp, &QNetworkReply::finished, resp, &QNetworkReply::deleteLater);
+}
+
+void MediaService::imgurTicketDone(const QString &ticket,
+                                   const QString &videoId,
+                                   const QString &videoDeletehash) {
+  ImgurTicket imgurTicket = m_imgurTickets.take(ticket);
+  traceSpan(imgurTicket.videoFile,
+            phaseSpan(MediaHost::Imgur, UploadPhase::Poll,
+                      imgurTicket.queuedAt));
+  imgurUpdateTitle(imgurTicket.videoFile, imgurTicket.videoTitle, videoId,
+                   videoDeletehash);
+}
+
+void MediaService::imgurTicketFailed(const QString &ticket,
+                                     const QString &error) {
+  ImgurTicket imgurTicket = m_imgurTickets.take(ticket);
+  UploadSpan pollSpan =
+      phaseSpan(MediaHost::Imgur, UploadPhase::Poll, imgurTicket.queuedAt);
+  pollSpan.error = error;
+  traceSpan(imgurTicket.videoFile, pollSpan);
+  emit this->mediaUploadError(imgurTicket.videoFile, error);
+}
+
+void MediaService::imgurUpdateTitle(QFile *videoFile,
+                                    const QString &videoTitle,
+                                    const QString &videoId,
+                                    const QString &videoDeletehash) {
+  QUrl reqUrl(m_imgurApiUrl + "/3/image/" + videoDeletehash);
+  reqUrl.setQuery("client_id=" + imgurClientId);
+  QNetworkReply *updateTitleResp = m_nam->post(
+      request(reqUrl), QJsonDocument(QJsonObject({{"title", videoTitle}}))
+                           .toJson(QJsonDocument::Compact));
+  trackTask(videoFile, updateTitleResp);
+  traceReply(videoFile, MediaHost::Imgur, UploadPhase::Metadata,
+             updateTitleResp);
   connect(
-      resp, &QNetworkReply::finished, this,
-      [this, resp, videoFile, videoFileName, videoMimeType, videoTitle]() {
-        if (resp->error() != QNetworkReply::NoError) {
-          emit this->mediaUploadError(videoFile, resp->errorString());
+      updateTitleResp, &QNetworkReply::finished, this,
+      [this, updateTitleResp, videoDeletehash, videoFile, videoId,
+       videoTitle]() {
+        if (updateTitleResp->error() != QNetworkReply::NoError) {
+          // The video is already up, so only the title update is repeated
+          if (retryPhase(m_jobs.value(videoFile), updateTitleResp,
+                         [this, videoDeletehash, videoFile, videoId,
+                          videoTitle]() {
+                           imgurUpdateTitle(videoFile, videoTitle, videoId,
+                                            videoDeletehash);
+                         }))
+            return;
+
+          emit this->mediaUploadError(videoFile,
+                                      updateTitleResp->errorString());
           return;
         }
 
-        QHttpMultiPart *uploadMultiPart =
-            new QHttpMultiPart(QHttpMultiPart::FormDataType);
+        emit this->mediaUploaded(videoFile, videoId,
+                                 m_imgurBaseUrl + "/" + videoId);
+      });
+  connect(updateTitleResp, &QNetworkReply::finished, updateTitleResp,
+          &QNetworkReply::deleteLater);
+}
+
+void MediaService::imgurUploadVideo(UploadJob *job) {
+  QFile *videoFile = job->videoFile;
+  FormDataDevice *uploadForm = bodyForm(job, "video");
 
-        QHttpPart videoFilePart;
-        videoFilePart.setHeader(QNetworkRequest::ContentTypeHeader,
-                                QVariant(videoMimeType));
-        videoFilePart.setHeader(
-            QNetworkRequest::ContentDispositionHeader,
-            QVariant("form-data; name=\"video\"; filename=\"" + videoFileName +
-                     "\""));
-        videoFile->open(QIODevice::ReadOnly);
-        videoFilePart.setBodyDevice(videoFile);
-        videoFile->setParent(uploadMultiPart);
-        uploadMultiPart->append(videoFilePart);
-
-        QUrl reqUrl(imgurApiUrl + "/3/image");
-        reqUrl.setQuery("client_id=" + imgurClientId);
-        auto uploadResp = m_nam->post(QNetworkRequest(reqUrl), uploadMultiPart);
-        connect(uploadResp, &QNetworkReply::uploadProgress, this,
-                [this, videoFile](qint64 bytesSent, qint64 bytesTotal) {
-                  emit this->mediaUploadProgress(videoFile, bytesSent,
-                                                 bytesTotal);
-                });
-        connect(
-            uploadResp, &QNetworkReply::finished, this,
-            [this, uploadResp, videoFile, videoTitle]() {
-              if (uploadResp->error() != QNetworkReply::NoError) {
-                emit this->mediaUploadError(videoFile,
-                                            uploadResp->errorString());
+  QUrl reqUrl(m_imgurApiUrl + "/3/image");
+  reqUrl.setQuery("client_id=" + imgurClientId);
+  auto uploadResp = postForm(MediaHost::Imgur, request(reqUrl), uploadForm);
+  trackTask(videoFile, uploadResp);
+  traceReply(videoFile, MediaHost::Imgur, UploadPhase::Body, uploadResp);
+  connect(uploadResp, &QNetworkReply::uploadProgress, this,
+          [this, videoFile](qint64 bytesSent, qint64 bytesTotal) {
+            reportProgress(videoFile, bytesSent, bytesTotal);
+          });
+  connect(uploadResp, &QNetworkReply::finished, this,
+          [this, jobId = job->id, uploadResp, videoFile]() {
+            UploadJob *job = liveJob(videoFile, jobId);
+
+            if (job == nullptr)
+              return;
+
+            if (uploadResp->error() != QNetworkReply::NoError) {
+              if (retryPhase(job, uploadResp,
+                             [this, job]() { imgurUploadVideo(job); }))
                 return;
-              }
 
-              QString uploadTicket =
-                  QJsonDocument::fromJson(uploadResp->readAll())
-                      .object()["data"]
-                      .toObject()["ticket"]
-                      .toString();
-
-              QTimer *timer = new QTimer;
-              connect(
-                  timer, &QTimer::timeout, this,
-                  [this, timer, uploadTicket, videoFile, videoTitle]() {
-                    qDebug() << "test";
-                    QUrl reqUrl(imgurBaseUrl + "/upload/poll");
-                    reqUrl.setQuery(QUrlQuery({{"client_id", imgurClientId},
-                                               {"tickets[]", uploadTicket}}));
-                    auto pollResp = m_nam->get(QNetworkRequest(reqUrl));
-                    connect(
-                        pollResp, &QNetworkReply::finished, this,
-                        [this, timer, pollResp, uploadTicket, videoFile,
-                         videoTitle]() {
-                          qDebug() << "test2";
-                          if (pollResp->error() != QNetworkReply::NoError) {
-                            emit this->mediaUploadError(
-                                videoFile, pollResp->errorString());
-                            return;
-                          }
-
-                          auto dataValue =
-                              QJsonDocument::fromJson(pollResp->readAll())
-                                  .object()["data"]
-                                  .toObject();
-                          qDebug() << dataValue;
-
-                          auto doneValue = dataValue["done"];
-                          auto doneEmpty = doneValue.isArray();
-
-                          if (doneValue.isObject()) {
-                            auto videoId =
-                                doneValue.toObject()[uploadTicket].toString();
-                            auto videoDeletehash = dataValue["images"]
-                                                       .toObject()[videoId]
-                                                       .toObject()["deletehash"]
-                                                       .toString();
-                            timer->stop();
-                            timer->deleteLater();
-                            QUrl reqUrl(imgurApiUrl + "/3/image/" +
-                                        videoDeletehash);
-                            reqUrl.setQuery("client_id=" + imgurClientId);
-                            auto updateTitleResp = m_nam->post(
-                                QNetworkRequest(reqUrl),
-                                QJsonDocument(
-                                    QJsonObject({{"title", videoTitle}}))
-                                    .toJson(QJsonDocument::Compact));
-                            connect(
-                                updateTitleResp, &QNetworkReply::finished, this,
-                                [this, updateTitleResp, videoFile, videoId]() {
-                                  if (updateTitleResp->error() !=
-                                      QNetworkReply::NoError) {
-                                    emit this->mediaUploadError(
-                                        videoFile,
-                                        updateTitleResp->errorString());
-                                    return;
-                                  }
-
-                                  emit this->mediaUploaded(videoFile, videoId,
-                                                           imgurBaseUrl + "/" +
-                                                               videoId);
-                                });
-                            connect(updateTitleResp, &QNetworkReply::finished,
-                                    updateTitleResp,
-                                    &QNetworkReply::deleteLater);
-                          }
-                        });
-                    connect(pollResp, &QNetworkReply::finished, pollResp,
-                            &QNetworkReply::deleteLater);
-                  });
-              timer->start(5000);
-            });
+              emit this->mediaUploadError(videoFile,
+                                          uploadResp->errorString());
+              return;
+            }
 
-        connect(uploadResp, &QNetworkReply::finished, uploadMultiPart,
-                &QHttpMultiPart::deleteLater);
-        connect(uploadResp, &QNetworkReply::finished, uploadResp,
-                &QNetworkReply::deleteLater);
-      });
-  connect(resp, &QNetworkReply::finished, resp, &QNetworkReply::deleteLater);
+            QString uploadTicket =
+                QJsonDocument::fromJson(uploadResp->readAll())
+                    .object()["data"]
+                    .toObject()["ticket"]
+                    .toString();
+
+            if (uploadTicket.isEmpty()) {
+              emit this->mediaUploadError(
+                  videoFile, "Imgur did not return an upload ticket!");
+              return;
+            }
+
+            job->phase = UploadPhase::Poll;
+            m_imgurTickets.insert(
+                uploadTicket, ImgurTicket{job->videoTitle, videoFile,
+                                          QDateTime::currentMSecsSinceEpoch()});
+            m_imgurPoller->setPollUrl(m_imgurBaseUrl + "/upload/poll");
+            m_imgurPoller->addTicket(uploadTicket);
+            journalRecord(videoFile, MediaHost::Imgur,
+                          QJsonObject{{"phase", "poll"},
+                                      {"ticket", uploadTicket},
+                                      {"videoTitle", job->videoTitle}});
+          });
+  connect(uploadResp, &QNetworkReply::finished, uploadResp,
+          &QNetworkReply::deleteLater);
 }
 
-void MediaService::uploadJustStreamLive(QFile *videoFile) {
-  QString videoFileName = QFileInfo(*videoFile).fileName();
-  QString videoMimeType = QMimeDatabase().mimeTypeForFile(videoFileName).name();
+bool MediaService::journalResume(UploadJob *job) {
+  if (!m_journal.isOpen())
+    return false;
 
-  if (!QStringList{"video/mp4", "video/webm", "video/x-matroska"}.contains(
-          videoMimeType)) {
-    emit this->mediaUploadError(
-        videoFile,
-        "Unsupported file type! JustStreamLive accepts MKV/MP4/WEBM!");
-    return;
+  MediaHost host = job->host;
+  QFile *videoFile = job->videoFile;
+  QString jobKey = UploadJournal::jobKey(host, videoFile->fileName());
+  QJsonObject journalJob = m_journal.job(jobKey);
+
+  if (journalJob.isEmpty())
+    return false;
+
+  // A job that keeps failing at the same phase is started over
+  int attempts = journalJob["attempts"].toInt() + 1;
+
+  if (attempts > UploadJournal::maxResumeAttempts) {
+    m_journal.removeJob(jobKey);
+    return false;
   }
 
-  if (videoFile->size() > 200 * 0x100000) {
-    emit this->mediaUploadError(
-        videoFile, "File too big! JustStreamLive supports 200MB maximum!");
-    return;
+  m_journalKeys.insert(videoFile, jobKey);
+  m_journal.updateJob(jobKey, QJsonObject{{"attempts", attempts}});
+
+  switch (host) {
+  case MediaHost::Dubz:
+    job->token = journalJob["token"].toString();
+    dubzUploadVideo(job);
+    return true;
+
+  case MediaHost::Imgur: {
+    QString ticket = journalJob["ticket"].toString();
+    job->phase = UploadPhase::Poll;
+    m_imgurTickets.insert(
+        ticket, ImgurTicket{journalJob["videoTitle"].toString(), videoFile,
+                            QDateTime::currentMSecsSinceEpoch()});
+    m_imgurPoller->setPollUrl(m_imgurBaseUrl + "/upload/poll");
+    m_imgurPoller->addTicket(ticket);
+    return true;
   }
 
-  QHttpMultiPart *uploadMultiPart =
-      new QHttpMultiPart(QHttpMultiPart::FormDataType);
+  case MediaHost::Streamable: {
+    job->token = journalJob["shortCode"].toString();
+    job->transcoderToken = journalJob["transcoderToken"].toString();
 
-  QHttpPart videoFilePart;
-  videoFilePart.setHeader(QNetworkRequest::ContentTypeHeader,
-                          QVariant(videoMimeType));
-  videoFilePart.setHeader(
-      QNetworkRequest::ContentDispositionHeader,
-      QVariant("form-data; name=\"file\"; filename=\"" + videoFileName + "\""));
-  videoFile->open(QIODevice::ReadOnly);
-  videoFilePart.setBodyDevice(videoFile);
-  videoFile->setParent(uploadMultiPart);
-  uploadMultiPart->append(videoFilePart);
+    // The body is already on S3, so the file is not read again
+    if (journalJob["phase"].toString() == "transcode") {
+      job->ownsFile = true;
+      sabTranscode(job);
+      return true;
+    }
 
-  QNetworkReply *resp = m_nam->post(
-      QNetworkRequest(QUrl(jslApiUrl + "/videos/upload")), uploadMultiPart);
+    job->accessKeyId = journalJob["accessKeyId"].toString();
+    job->secretAccessKey = journalJob["secretAccessKey"].toString();
+    job->sessionToken = journalJob["sessionToken"].toString();
+    job->awsRegion = journalJob["awsRegion"].toString();
+    StreamableUploadMode uploadMode = journalJob.contains("uploadId")
+                                          ? StreamableUploadMode::Multipart
+                                          : m_streamableUploadMode;
 
-  connect(resp, &QNetworkReply::uploadProgress, this,
-          [this, videoFile](qint64 bytesSent, qint64 bytesTotal) {
-            emit this->mediaUploadProgress(videoFile, bytesSent, bytesTotal);
-          });
-  connect(resp, &QNetworkReply::finished, this, [this, resp, videoFile]() {
-    if (resp->error() != QNetworkReply::NoError) {
-      emit this->mediaUploadError(videoFile, resp->errorString());
-      return;
-    }
+    if (uploadMode == StreamableUploadMode::SignedPayload &&
+        !job->payloadHash.isValid())
+      job->payloadHash = payloadHash(videoFile);
 
-    QString videoId =
-        QJsonDocument::fromJson(resp->readAll()).object()["id"].toString();
-    emit this->mediaUploaded(videoFile, videoId, jslBaseUrl + "/" + videoId);
-  });
-  connect(resp, &QNetworkReply::finished, uploadMultiPart,
-          &QHttpMultiPart::deleteLater);
-  connect(resp, &QNetworkReply::finished, resp, &QNetworkReply::deleteLater);
-}
+    sabUploadBody(job, uploadMode);
+    return true;
+  }
 
-void MediaService::uploadStreamable(QFile *videoFile, const QString &videoTitle,
-                                    const QString &awsRegion) {
-  QString videoFileName = QFileInfo(*videoFile).fileName();
-  QString videoMimeType = QMimeDatabase().mimeTypeForFile(videoFileName).name();
+  case MediaHost::Streamff:
+    job->token = journalJob["token"].toString();
+    sffUploadVideo(job);
+    return true;
 
-  if (!QStringList{"video/mp4", "video/x-matroska"}.contains(videoMimeType)) {
-    emit this->mediaUploadError(
-        videoFile, "Unsupported file type! Streamable only accepts MKV/MP4!");
-    return;
+  case MediaHost::Streamja:
+    job->token = journalJob["token"].toString();
+    sjaUploadVideo(job);
+    return true;
+
+  default:
+    m_journalKeys.remove(videoFile);
+    return false;
   }
+}
 
-  if (videoFile->size() > 250 * 0x100000) {
-    emit this->mediaUploadError(
-        videoFile, "File too big! Streamable supports 250MB maximum!");
+void MediaService::journalRecord(QFile *videoFile, MediaHost host,
+                                 const QJsonObject &fields) {
+  if (!m_journal.isOpen())
     return;
-  }
 
-  QUrl shortcodeUrl(sabApiUrl + "/shortcode");
-  shortcodeUrl.setQuery(
-      QUrlQuery{{"version", sabReactVersion},
-                {"size", QString::number(videoFile->size())}});
-  QNetworkReply *generateResp = m_nam->get(QNetworkRequest(shortcodeUrl));
-  connect(
-      generateResp, &QNetworkReply::finished, this,
-      [this, awsRegion, generateResp, videoFile, videoFileName, videoTitle]() {
-        if (generateResp->error() != QNetworkReply::NoError) {
-          emit this->mediaUploadError(videoFile, generateResp->errorString());
-          return;
-        }
+  QString &jobKey = m_journalKeys[videoFile];
+
+  if (jobKey.isEmpty())
+    jobKey = UploadJournal::jobKey(host, videoFile->fileName());
+
+  QJsonObject jobFields = fields;
+  jobFields["host"] = static_cast<int>(host);
+  jobFields["fileName"] = QFileInfo(*videoFile).absoluteFilePath();
+  m_journal.updateJob(jobKey, jobFields);
+}
+
+void MediaService::jslUploadVideo(UploadJob *job) {
+  QFile *videoFile = job->videoFile;
+  QNetworkReply *uploadResp =
+      postForm(MediaHost::JustStreamLive,
+               request(QUrl(m_jslApiUrl + "/videos/upload")),
+               bodyForm(job, "file"));
+  trackTask(videoFile, uploadResp);
+  traceReply(videoFile, MediaHost::JustStreamLive, UploadPhase::Body,
+             uploadResp);
+
+  connect(uploadResp, &QNetworkReply::uploadProgress, this,
+          [this, videoFile](qint64 bytesSent, qint64 bytesTotal) {
+            reportProgress(videoFile, bytesSent, bytesTotal);
+          });
+  connect(uploadResp, &QNetworkReply::finished, this,
+          [this, jobId = job->id, uploadResp, videoFile]() {
+            UploadJob *job = liveJob(videoFile, jobId);
+
+            if (job == nullptr)
+              return;
 
-        QJsonObject generateJson =
-            QJsonDocument::fromJson(generateResp->readAll()).object();
-        QString shortCode = generateJson["shortcode"].toString();
-        QString accessKeyId =
-            generateJson["credentials"].toObject()["accessKeyId"].toString();
-        QString secretAccessKey = generateJson["credentials"]
-                                      .toObject()["secretAccessKey"]
-                                      .toString();
-        QString sessionToken =
-            generateJson["credentials"].toObject()["sessionToken"].toString();
-        QString transcoderToken =
-            generateJson["transcoder_options"].toObject()["token"].toString();
-
-        QUrl updateMetaUrl(sabApiUrl + "/videos/" + shortCode);
-        updateMetaUrl.setQuery(QUrlQuery{{"purge", ""}});
-        QJsonObject videoMetaJson;
-        videoMetaJson["original_name"] = videoFileName;
-        videoMetaJson["original_size"] = videoFile->size();
-        videoMetaJson["title"] = videoTitle.isEmpty()
-                                     ? QFileInfo(*videoFile).baseName()
-                                     : videoTitle;
-        videoMetaJson["upload_source"] = "web";
-        QNetworkRequest updateMetaReq(updateMetaUrl);
-        updateMetaReq.setHeader(QNetworkRequest::ContentTypeHeader,
-                                "application/json");
-        QNetworkReply *updateMetaResp = m_nam->put(
-            updateMetaReq,
-            QJsonDocument(videoMetaJson).toJson(QJsonDocument::Compact));
-        connect(
-            updateMetaResp, &QNetworkReply::finished, this,
-            [this, accessKeyId, awsRegion, secretAccessKey, sessionToken,
-             shortCode, transcoderToken, updateMetaResp, videoFile]() {
-              if (updateMetaResp->error() != QNetworkReply::NoError) {
-                emit this->mediaUploadError(videoFile,
-                                            updateMetaResp->errorString());
+            if (uploadResp->error() != QNetworkReply::NoError) {
+              if (retryPhase(job, uploadResp,
+                             [this, job]() { jslUploadVideo(job); }))
                 return;
-              }
 
-              QNetworkRequest uploadReq(
-                  QUrl(sabAwsUrl + "/upload/" + shortCode));
-              uploadReq.setHeader(QNetworkRequest::ContentTypeHeader,
-                                  "application/octet-stream");
-              uploadReq.setRawHeader("x-amz-security-token",
-                                     sessionToken.toUtf8());
-              uploadReq.setRawHeader("x-amz-acl", "public-read");
-
-              QCryptographicHash sha256Hash(QCryptographicHash::Sha256);
-              videoFile->open(QFile::ReadOnly);
-              sha256Hash.addData(videoFile);
-              QString payloadHash = sha256Hash.result().toHex().toLower();
-              uploadReq.setRawHeader("x-amz-content-sha256",
-                                     payloadHash.toUtf8());
-
-              QDateTime reqTime = QDateTime::currentDateTimeUtc();
-              uploadReq.setRawHeader(
-                  "x-amz-date", reqTime.toString("yyyyMMddTHHmmssZ").toUtf8());
-
-              QMap<QString, QByteArray> canonicalHeaders;
-
-              for (auto &&hKey : uploadReq.rawHeaderList()) {
-                QString hKeyStr(hKey);
-
-                if (hKeyStr.toLower() == "content-type" ||
-                    hKeyStr.toLower() == "host" ||
-                    hKeyStr.toLower().startsWith("x-amz-"))
-                  canonicalHeaders[hKeyStr.toLower()] =
-                      uploadReq.rawHeader(hKey);
-              }
+              emit this->mediaUploadError(videoFile,
+                                          uploadResp->errorString());
+              return;
+            }
 
-              if (!canonicalHeaders.contains("host"))
-                canonicalHeaders["host"] =
-                    "streamables-upload.s3.amazonaws.com";
-
-              QString canonicalHeadersStr("");
-
-              for (auto &&hKey : canonicalHeaders.keys())
-                canonicalHeadersStr +=
-                    hKey + ":" + QString(canonicalHeaders[hKey] + "\n");
-              QString canonicalRequest =
-                  QStringList{"PUT",
-                              "/upload/" + shortCode,
-                              "",
-                              canonicalHeadersStr,
-                              canonicalHeaders.keys().join(";"),
-                              payloadHash}
-                      .join("\n");
-
-              sha256Hash.reset();
-              sha256Hash.addData(canonicalRequest.toUtf8());
-              QString scope =
-                  QStringList{reqTime.date().toString("yyyyMMdd"),
-                              awsRegion.isEmpty() ? "us-east-1" : awsRegion,
-                              "s3", "aws4_request"}
-                      .join("/");
-
-              QString strToSign =
-                  QStringList{"AWS4-HMAC-SHA256",
-                              reqTime.toString("yyyyMMddTHHmmssZ"), scope,
-                              sha256Hash.result().toHex().toLower()}
-                      .join("\n");
-
-              QMessageAuthenticationCode hmacSha256(QCryptographicHash::Sha256);
-              hmacSha256.setKey(("AWS4" + secretAccessKey).toUtf8());
-              hmacSha256.addData(reqTime.date().toString("yyyyMMdd").toUtf8());
-              QByteArray dateKey = hmacSha256.result();
-              hmacSha256.reset();
-              hmacSha256.setKey(dateKey);
-              hmacSha256.addData(awsRegion.toUtf8());
-              QByteArray dateRegionKey = hmacSha256.result();
-              hmacSha256.reset();
-              hmacSha256.setKey(dateRegionKey);
-              hmacSha256.addData("s3");
-              QByteArray dateRegionServiceKey = hmacSha256.result();
-              hmacSha256.reset();
-              hmacSha256.setKey(dateRegionServiceKey);
-              hmacSha256.addData("aws4_request");
-              QByteArray signingKey = hmacSha256.result();
-              hmacSha256.reset();
-              hmacSha256.setKey(signingKey);
-              hmacSha256.addData(strToSign.toUtf8());
-              QString signature = hmacSha256.result().toHex().toLower();
-              QString authorization =
-                  "AWS4-HMAC-SHA256 Credential=" + accessKeyId + "/" + scope +
-                  ",SignedHeaders=" + canonicalHeaders.keys().join(";") +
-                  ",Signature=" + signature;
-
-              uploadReq.setRawHeader("Authorization", authorization.toUtf8());
-              videoFile->seek(0);
-              QNetworkReply *uploadResp = m_nam->put(uploadReq, videoFile);
-
-              connect(uploadResp, &QNetworkReply::uploadProgress, this,
-                      [this, videoFile](qint64 bytesSent, qint64 bytesTotal) {
-                        emit this->mediaUploadProgress(videoFile, bytesSent,
-                                                       bytesTotal);
-                      });
-
-              connect(
-                  uploadResp, &QNetworkReply::finished, this,
-                  [this, shortCode, transcoderToken, uploadResp, videoFile]() {
-                    if (uploadResp->error() != QNetworkReply::NoError) {
-                      emit this->mediaUploadError(videoFile,
-                                                  uploadResp->errorString());
-                      return;
-                    }
-
-                    QNetworkRequest transcodeReq(
-                        QUrl(sabApiUrl + "/transcode/" + shortCode));
-                    transcodeReq.setHeader(QNetworkRequest::ContentTypeHeader,
-                                           "application/json");
-
-                    QNetworkReply *transcodeResp = m_nam->post(
-                        transcodeReq,
-                        QJsonDocument(
-                            QJsonObject{
-                                {"shortcode", shortCode},
-                                {"size", videoFile->size()},
-                                {"token", transcoderToken},
-                                {"upload_source", "web"},
-                                {"url", sabAwsUrl + "/upload/" + shortCode}})
-                            .toJson(QJsonDocument::Compact));
-
-                    connect(transcodeResp, &QNetworkReply::finished, this,
-                            [this, shortCode, transcodeResp, videoFile]() {
-                              if (transcodeResp->error() !=
-                                  QNetworkReply::NoError) {
-                                emit this->mediaUploadError(
-                                    videoFile, transcodeResp->errorString());
-                                return;
-                              }
-
-                              emit this->mediaUploaded(videoFile, shortCode,
-                                                       sabBaseUrl + "/" +
-                                                           shortCode);
-                            });
-                    connect(transcodeResp, &QNetworkReply::finished,
-                            transcodeResp, &QNetworkReply::deleteLater);
-                  });
-              connect(uploadResp, &QNetworkReply::finished, uploadResp,
-                      &QNetworkReply::deleteLater);
-              connect(uploadResp, &QNetworkReply::finished, videoFile,
-                      &QFile::deleteLater);
-            });
-        connect(updateMetaResp, &QNetworkReply::finished, updateMetaResp,
-                &QNetworkReply::deleteLater);
-      });
-  connect(generateResp, &QNetworkReply::finished, generateResp,
+            QString videoId = QJsonDocument::fromJson(uploadResp->readAll())
+                                  .object()["id"]
+                                  .toString();
+            emit this->mediaUploaded(videoFile, videoId,
+                                     m_jslBaseUrl + "/" + videoId);
+          });
+  connect(uploadResp, &QNetworkReply::finished, uploadResp,
           &QNetworkReply::deleteLater);
 }
 
-void MediaService::uploadStreamff(QFile *videoFile) {
-  QString videoFileName = QFileInfo(*videoFile).fileName();
-  QString videoMimeType = QMimeDatabase().mimeTypeForFile(videoFileName).name();
+// The job a callback was created for, or nullptr once that upload reported
+// its result and the job went back to the pool. Callbacks capture the job's
+// ID rather than the job, which may since run another upload or be freed.
+UploadJob *MediaService::liveJob(QFile *videoFile, quint64 jobId) const {
+  UploadJob *job = m_jobs.value(videoFile);
+  return job != nullptr && job->id == jobId ? job : nullptr;
+}
 
-  if (videoMimeType != "video/mp4") {
-    emit this->mediaUploadError(
-        videoFile, "Unsupported file type! Streamff accepts MP4 only!");
-    return;
-  }
+void MediaService::finishJob(QFile *videoFile) {
+  UploadJob *job = m_jobs.take(videoFile);
 
-  if (videoFile->size() > 200 * 0x100000) {
-    emit this->mediaUploadError(
-        videoFile, "File too big! Streamff supports 200MB maximum!");
+  if (job == nullptr)
     return;
-  }
 
-  QNetworkReply *generateResp = m_nam->post(
-      QNetworkRequest(QUrl(sffBaseUrl + "/api/videos/generate-link")),
-      QByteArray());
-  QNetworkAccessManager *nam = m_nam;
+  if (job->ownsFile)
+    videoFile->deleteLater();
 
-  connect(
-      generateResp, &QNetworkReply::finished, this,
-      [this, generateResp, nam, videoFile, videoFileName, videoMimeType]() {
-        if (generateResp->error() != QNetworkReply::NoError) {
-          emit this->mediaUploadError(videoFile, generateResp->errorString());
-          return;
-        }
+  m_jobPool.release(job);
+}
+
+void MediaService::flushProgress() {
+  for (auto &&videoFile : m_progress.takeDue())
+    publishProgress(videoFile);
+
+  int nextDue = m_progress.nextDue();
+
+  if (nextDue >= 0)
+    m_progressTimer.start(nextDue);
+}
+
+// Files that cannot be mapped (empty, special or too large for the address
+// space) return a null pointer and are read through the QFile instead
+QSharedPointer<MappedFile> MediaService::mapFile(QFile *videoFile) {
+  if (m_mappedFiles.contains(videoFile))
+    return m_mappedFiles.value(videoFile);
+
+  QSharedPointer<MappedFile> mappedFile(
+      new MappedFile(videoFile->fileName()));
+
+  if (!mappedFile->open())
+    return QSharedPointer<MappedFile>();
+
+  m_mappedFiles.insert(videoFile, mappedFile);
+  connect(videoFile, &QObject::destroyed, this,
+          [this, videoFile]() { m_mappedFiles.remove(videoFile); });
+  return mappedFile;
+}
+
+const UploadMetrics &MediaService::metrics() const { return m_metrics; }
+
+// The body of one attempt. A device other than the file itself has no parent
+// and belongs to whatever sends it. The file is only rewound, since it stays
+// with the job and is deleted once the upload reports its result.
+QIODevice *MediaService::openBody(UploadJob *job) {
+  QFile *videoFile = job->videoFile;
+  job->ownsFile = true;
+  auto handle = m_fanOutHandles.constFind(videoFile);
 
-        QString videoId(generateResp->readAll());
-        QHttpMultiPart *uploadMultiPart =
-            new QHttpMultiPart(QHttpMultiPart::FormDataType);
-
-        QHttpPart videoFilePart;
-        videoFilePart.setHeader(QNetworkRequest::ContentTypeHeader,
-                                QVariant(videoMimeType));
-        videoFilePart.setHeader(
-            QNetworkRequest::ContentDispositionHeader,
-            QVariant("form-data; name=\"file\"; filename=\"" + videoFileName +
-                     "\""));
+  if (handle == m_fanOutHandles.constEnd()) {
+    QSharedPointer<MappedFile> mappedFile = mapFile(videoFile);
+
+    if (mappedFile.isNull()) {
+      if (!videoFile->isOpen())
         videoFile->open(QIODevice::ReadOnly);
-        videoFilePart.setBodyDevice(videoFile);
-        videoFile->setParent(uploadMultiPart);
-        uploadMultiPart->append(videoFilePart);
-
-        QNetworkReply *uploadResp = nam->post(
-            QNetworkRequest(QUrl(sffBaseUrl + "/api/videos/upload/" + videoId)),
-            uploadMultiPart);
-        connect(uploadResp, &QNetworkReply::uploadProgress, this,
-                [this, videoFile](qint64 bytesSent, qint64 bytesTotal) {
-                  emit this->mediaUploadProgress(videoFile, bytesSent,
-                                                 bytesTotal);
-                });
-        connect(uploadResp, &QNetworkReply::finished, this,
-                [this, videoId, uploadResp, videoFile]() {
-                  if (uploadResp->error() != QNetworkReply::NoError) {
-                    emit this->mediaUploadError(videoFile,
-                                                uploadResp->errorString());
-                    return;
-                  }
-
-                  emit this->mediaUploaded(videoFile, videoId,
-                                           sffBaseUrl + "/v/" + videoId);
-                });
-        connect(uploadResp, &QNetworkReply::finished, uploadMultiPart,
-                &QHttpMultiPart::deleteLater);
-        connect(uploadResp, &QNetworkReply::finished, uploadResp,
-                &QNetworkReply::deleteLater);
-      });
-  connect(generateResp, &QNetworkReply::finished, generateResp,
-          &QNetworkReply::deleteLater);
+
+      videoFile->seek(0);
+      return videoFile;
+    }
+
+    MappedFileDevice *bodyDevice = new MappedFileDevice(mappedFile);
+    bodyDevice->open(QIODevice::ReadOnly);
+    return bodyDevice;
+  }
+
+  // Registered only once the body is read, so hosts still fetching a token
+  // or waiting for a payload hash do not hold the shared window back
+  handle->reader->addConsumer(videoFile);
+  SharedFileDevice *bodyDevice =
+      new SharedFileDevice(handle->reader, videoFile);
+  bodyDevice->open(QIODevice::ReadOnly);
+  return bodyDevice;
 }
 
-void MediaService::uploadStreamja(QFile *videoFile) {
-  QString videoFileName = QFileInfo(*videoFile).fileName();
-  QString videoMimeType = QMimeDatabase().mimeTypeForFile(videoFileName).name();
+UploadSpan MediaService::phaseSpan(MediaHost host, UploadPhase phase,
+                                   qint64 startTime) {
+  UploadSpan span;
+  span.host = host;
+  span.phase = phase;
+  span.startTime = startTime;
+  span.endTime = QDateTime::currentMSecsSinceEpoch();
+  span.bytesSent = 0;
+  span.bytesReceived = 0;
+  span.httpStatus = 0;
+  span.retries = 0;
+  span.connectionReused = false;
+  return span;
+}
 
-  if (videoMimeType != "video/mp4") {
-    emit this->mediaUploadError(
-        videoFile, "Unsupported file type! Streamja only accepts MP4!");
-    return;
+QString MediaService::parseUploadToken(MediaHost host,
+                                       const QByteArray &respData) {
+  switch (host) {
+  case MediaHost::Dubz: {
+    DubzLinkIdScanner linkIdScanner;
+    linkIdScanner.feed(respData);
+    return linkIdScanner.linkId();
   }
 
-  if (videoFile->size() > 30 * 0x100000) {
-    emit this->mediaUploadError(
-        videoFile, "File too big! Streamja supports 30MB maximum!");
-    return;
+  case MediaHost::Streamff:
+    return QString(respData);
+
+  case MediaHost::Streamja:
+    return QJsonDocument::fromJson(respData).object()["shortId"].toString();
+
+  default:
+    return QString();
+  }
+}
+
+QFuture<QByteArray> MediaService::payloadHash(QFile *videoFile) {
+  // Already hashed for the upload cache
+  if (m_contentDigests.contains(videoFile)) {
+    QPromise<QByteArray> digestPromise;
+    digestPromise.start();
+    digestPromise.addResult(m_contentDigests.value(videoFile));
+    digestPromise.finish();
+    return digestPromise.future();
   }
 
-  QNetworkAccessManager *nam = m_nam;
+  QSharedPointer<MappedFile> mappedFile = mapFile(videoFile);
 
-  QNetworkRequest generateReq(QUrl(sjaBaseUrl + "/shortId.php"));
-  generateReq.setHeader(QNetworkRequest::ContentTypeHeader,
-                        "application/x-www-form-urlencoded");
-  QNetworkReply *generateResp =
-      nam->post(generateReq,
-                QUrlQuery{{"new", "1"}}.toString(QUrl::FullyEncoded).toUtf8());
+  if (mappedFile.isNull())
+    return FileDigest::sha256(videoFile->fileName());
+
+  return FileDigest::sha256(mappedFile);
+}
+
+QNetworkReply *MediaService::postForm(MediaHost host, QNetworkRequest req,
+                                      FormDataDevice *formData) {
+  req.setHeader(QNetworkRequest::ContentTypeHeader, formData->contentType());
+  QNetworkReply *reply =
+      sendBody(host, QNetworkAccessManager::PostOperation, req, formData);
+  formData->setParent(reply);
+  return reply;
+}
+
+void MediaService::publishProgress(QFile *videoFile) {
+  ProgressSnapshot snapshot = m_progress.snapshot(videoFile);
+
+  if (m_progressRing != nullptr)
+    m_progressRing->push(snapshot);
+
+  emit this->mediaUploadProgress(videoFile, snapshot.bytesSent,
+                                 snapshot.bytesTotal);
+}
+
+QNetworkRequest MediaService::request(const QUrl &url) const {
+  QNetworkRequest req(url);
+  req.setAttribute(QNetworkRequest::Http2AllowedAttribute, m_http2Allowed);
+  return req;
+}
+
+// Fetches the Dubz link ID, Streamff video ID or Streamja short ID for a job
+// that found none in the token pool, then sends its body
+void MediaService::requestJobToken(UploadJob *job) {
+  QFile *videoFile = job->videoFile;
+  QNetworkReply *tokenResp = requestUploadToken(job->host);
+  trackTask(videoFile, tokenResp);
+  traceReply(videoFile, job->host, UploadPhase::Token, tokenResp);
+
+  connect(tokenResp, &QNetworkReply::finished, this,
+          [this, jobId = job->id, tokenResp, videoFile]() {
+            UploadJob *job = liveJob(videoFile, jobId);
+
+            if (job == nullptr)
+              return;
+
+            job->token = uploadToken(job->host, tokenResp);
+
+            if (job->token.isEmpty() &&
+                tokenResp->error() != QNetworkReply::NoError) {
+              if (retryPhase(job, tokenResp,
+                             [this, job]() { requestJobToken(job); }))
+                return;
 
-  connect(generateResp, &QNetworkReply::finished, this,
-          [this, generateResp, nam, videoFile, videoFileName, videoMimeType]() {
-            if (generateResp->error() != QNetworkReply::NoError) {
               emit this->mediaUploadError(videoFile,
-                                          generateResp->errorString());
+                                          tokenResp->errorString());
               return;
             }
 
-            QString shortId = QJsonDocument::fromJson(generateResp->readAll())
-                                  .object()["shortId"]
-                                  .toString();
+            switch (job->host) {
+            case MediaHost::Dubz:
+              if (job->token.isEmpty()) {
+                emit this->mediaUploadError(
+                    videoFile, "Failed to find link ID on Dubz home page!");
+                return;
+              }
 
-            QHttpMultiPart *uploadMultiPart =
-                new QHttpMultiPart(QHttpMultiPart::FormDataType);
-
-            QHttpPart videoFilePart;
-            videoFilePart.setHeader(QNetworkRequest::ContentTypeHeader,
-                                    QVariant(videoMimeType));
-            videoFilePart.setHeader(
-                QNetworkRequest::ContentDispositionHeader,
-                QVariant("form-data; name=\"file\"; filename=\"" +
-                         videoFileName + "\""));
-            videoFile->open(QIODevice::ReadOnly);
-            videoFilePart.setBodyDevice(videoFile);
-            videoFile->setParent(uploadMultiPart);
-            uploadMultiPart->append(videoFilePart);
-
-            QUrl uploadUrl(sjaBaseUrl + "/upload.php");
-            QUrlQuery uploadQuery{{"shortId", shortId}};
-            uploadUrl.setQuery(uploadQuery);
-
-            QNetworkReply *uploadResp =
-                nam->post(QNetworkRequest(uploadUrl), uploadMultiPart);
-            connect(uploadResp, &QNetworkReply::uploadProgress, this,
-                    [this, videoFile](qint64 bytesSent, qint64 bytesTotal) {
-                      emit this->mediaUploadProgress(videoFile, bytesSent,
-                                                     bytesTotal);
-                    });
-            connect(uploadResp, &QNetworkReply::finished, this,
-                    [this, shortId, uploadResp, videoFile]() {
-                      if (uploadResp->error() != QNetworkReply::NoError) {
-                        emit this->mediaUploadError(videoFile,
-                                                    uploadResp->errorString());
-                        return;
-                      }
-
-                      emit this->mediaUploaded(videoFile, shortId,
-                                               sjaBaseUrl + "/" + shortId);
-                    });
-            connect(uploadResp, &QNetworkReply::finished, uploadMultiPart,
-                    &QHttpMultiPart::deleteLater);
-            connect(uploadResp, &QNetworkReply::finished, uploadResp,
-                    &QNetworkReply::deleteLater);
-          });
+              dubzUploadVideo(job);
+              break;
 
-  connect(generateResp, &QNetworkReply::finished, generateResp,
+            case MediaHost::Streamff:
+              sffUploadVideo(job);
+              break;
+
+            case MediaHost::Streamja:
+              sjaUploadVideo(job);
+              break;
+
+            default:
+              break;
+            }
+          });
+  connect(tokenResp, &QNetworkReply::finished, tokenResp,
           &QNetworkReply::deleteLater);
 }
+
+QNetworkReply *MediaService::requestUploadToken(MediaHost host) {
+  switch (host) {
+  case MediaHost::Dubz: {
+    QNetworkReply *homePageResp = m_nam->get(request(QUrl(m_dubzUrl)));
+    m_linkIdScanners.insert(homePageResp, DubzLinkIdScanner());
+
+    // Nothing after the link ID is needed, so the rest of the page is not
+    // downloaded
+    connect(homePageResp, &QNetworkReply::readyRead, this,
+            [this, homePageResp]() {
+              if (m_linkIdScanners[homePageResp].feed(homePageResp->readAll()))
+                homePageResp->abort();
+            });
+    connect(homePageResp, &QObject::destroyed, this, [this, homePageResp]() {
+      m_linkIdScanners.remove(homePageResp);
+    });
+    return homePageResp;
+  }
+
+  case MediaHost::Streamff:
+    return m_nam->post(
+        request(QUrl(m_sffBaseUrl + "/api/videos/generate-link")),
+        QByteArray());
+
+  case MediaHost::Streamja: {
+    QNetworkRequest generateReq = request(QUrl(m_sjaBaseUrl + "/shortId.php"));
+    generateReq.setHeader(QNetworkRequest::ContentTypeHeader,
+                          "application/x-www-form-urlencoded");
+    return m_nam->post(
+        generateReq,
+        QUrlQuery{{"new", "1"}}.toString(QUrl::FullyEncoded).toUtf8());
+  }
+
+  default:
+    return nullptr;
+  }
+}
+
+void MediaService::resetMetrics() { m_metrics.reset(); }
+
+void MediaService::reportProgress(QFile *videoFile, qint64 bytesSent,
+                                  qint64 bytesTotal) {
+  if (m_progress.update(videoFile, bytesSent, bytesTotal)) {
+    publishProgress(videoFile);
+    return;
+  }
+
+  if (!m_progressTimer.isActive())
+    m_progressTimer.start(m_progress.nextDue());
+}
+
+// Futures are finished from the event loop rather than inside the result
+// signal, so continuations and awaiting coroutines never run while the
+// service is still delivering it
+void MediaService::resolveUpload(QFile *videoFile, UploadResult result) {
+  if (!m_uploadResults.contains(videoFile))
+    return;
+
+  PendingResult pendingResult = m_uploadResults.take(videoFile);
+  result.videoFile = videoFile;
+  result.host = pendingResult.host;
+  QMetaObject::invokeMethod(
+      this,
+      [pendingResult, result]() {
+        pendingResult.promise->addResult(result);
+        pendingResult.promise->finish();
+      },
+      Qt::QueuedConnection);
+}
+
+void MediaService::resumeJournal() {
+  QSet<QString> runningKeys(m_journalKeys.cbegin(), m_journalKeys.cend());
+
+  for (auto &&jobKey : m_journal.jobKeys()) {
+    if (runningKeys.contains(jobKey))
+      continue;
+
+    QJsonObject job = m_journal.job(jobKey);
+    MediaHost host = static_cast<MediaHost>(job["host"].toInt());
+    QFile *videoFile = new QFile(job["fileName"].toString(), this);
+    emit this->uploadResumed(videoFile, host);
+    upload(host, videoFile, job["videoTitle"].toString(),
+           job["awsRegion"].toString());
+  }
+}
+
+// Runs a failed phase again after the policy's backoff. The job keeps every
+// identifier it already holds, so only the request that failed is repeated.
+// Returns false when the failure is permanent, out of attempts or canceled
+// and should be reported.
+bool MediaService::retryPhase(UploadJob *job, QNetworkReply *reply,
+                              const std::function<void()> &rerun) {
+  if (job == nullptr || job->status != UploadJob::Status::Running ||
+      !m_retryPolicy.shouldRetry(job->host, job->phase, job->attempts, reply))
+    return false;
+
+  // Tracked like any other task so canceling the upload stops the wait. The
+  // phase is only run again while the job has not been released, so rerun
+  // may keep using the job it captured.
+  QTimer *retryTimer = new QTimer(this);
+  retryTimer->setSingleShot(true);
+  connect(retryTimer, &QTimer::timeout, this,
+          [this, jobId = job->id, rerun, videoFile = job->videoFile]() {
+            if (liveJob(videoFile, jobId) != nullptr)
+              rerun();
+          });
+  connect(retryTimer, &QTimer::timeout, retryTimer, &QTimer::deleteLater);
+  trackTask(job->videoFile, retryTimer);
+  retryTimer->start(
+      m_retryPolicy.delay(job->host, job->phase, job->attempts, reply));
+  return true;
+}
+
+const RetryPolicy &MediaService::retryPolicy() const { return m_retryPolicy; }
+
+void MediaService::sabRequestShortcode(UploadJob *job,
+                                       StreamableUploadMode uploadMode) {
+  QFile *videoFile = job->videoFile;
+  QUrl shortcodeUrl(m_sabApiUrl + "/shortcode");
+  shortcodeUrl.setQuery(QUrlQuery{{"version", sabReactVersion},
+                                  {"size", QString::number(job->videoSize)}});
+  QNetworkReply *generateResp = m_nam->get(request(shortcodeUrl));
+  trackTask(videoFile, generateResp);
+  traceReply(videoFile, MediaHost::Streamable, UploadPhase::Token,
+             generateResp);
+  connect(generateResp, &QNetworkReply::finished, this,
+          [this, generateResp, jobId = job->id, uploadMode, videoFile]() {
+            UploadJob *job = liveJob(videoFile, jobId);
+
+            if (job == nullptr)
+              return;
+
+            if (generateResp->error() != QNetworkReply::NoError) {
+              if (retryPhase(job, generateResp, [this, job, uploadMode]() {
+                    sabRequestShortcode(job, uploadMode);
+                  }))
+                return;
+
+              emit this->mediaUploadError(videoFile,
+                                          generateResp->errorString());
+              return;
+            }
+
+            QJsonObject generateJson =
+                QJsonDocument::fromJson(generateResp->readAll()).object();
+            QJsonObject credentials = generateJson["credentials"].toObject();
+            job->token = generateJson["shortcode"].toString();
+            job->accessKeyId = credentials["accessKeyId"].toString();
+            job->secretAccessKey = credentials["secretAccessKey"].toString();
+            job->sessionToken = credentials["sessionToken"].toString();
+            job->transcoderToken = generateJson["transcoder_options"]
+                                       .toObject()["token"]
+                                       .toString();
+            sabUpdateMetadata(job, uploadMode);
+          });
+  connect(generateResp, &QNetworkReply::finished, generateResp,
+          &QNetworkReply::deleteLater);
+}
+
+// Only called once the body is confirmed, so the file handle may be gone
+// and only the job's copy of its size is used
+void MediaService::sabTranscode(UploadJob *job) {
+  QFile *videoFile = job->videoFile;
+  QNetworkRequest transcodeReq =
+      request(QUrl(m_sabApiUrl + "/transcode/" + job->token));
+  transcodeReq.setHeader(QNetworkRequest::ContentTypeHeader,
+                         "application/json");
+
+  QNetworkReply *transcodeResp = m_nam->post(
+      transcodeReq,
+      QJsonDocument(QJsonObject{{"shortcode", job->token},
+                                {"size", job->videoSize},
+                                {"token", job->transcoderToken},
+                                {"upload_source", "web"},
+                                {"url", m_sabAwsUrl + "/upload/" + job->token}})
+          .toJson(QJsonDocument::Compact));
+  trackTask(videoFile, transcodeResp);
+  traceReply(videoFile, MediaHost::Streamable, UploadPhase::Transcode,
+             transcodeResp);
+
+  connect(transcodeResp, &QNetworkReply::finished, this,
+          [this, jobId = job->id, transcodeResp, videoFile]() {
+            UploadJob *job = liveJob(videoFile, jobId);
+
+            if (job == nullptr)
+              return;
+
+            if (transcodeResp->error() != QNetworkReply::NoError) {
+              // The body is already on S3, only the transcode is repeated
+              if (retryPhase(job, transcodeResp,
+                             [this, job]() { sabTranscode(job); }))
+                return;
+
+              emit this->mediaUploadError(videoFile,
+                                          transcodeResp->errorString());
+              return;
+            }
+
+            // The job is released while the signal is delivered
+            QString shortCode = job->token;
+            emit this->mediaUploaded(videoFile, shortCode,
+                                     m_sabBaseUrl + "/" + shortCode);
+          });
+  connect(transcodeResp, &QNetworkReply::finished, transcodeResp,
+          &QNetworkReply::deleteLater);
+}
+
+// Retries keep the shortcode and credentials already handed out
+void MediaService::sabUpdateMetadata(UploadJob *job,
+                                     StreamableUploadMode uploadMode) {
+  QFile *videoFile = job->videoFile;
+  QUrl updateMetaUrl(m_sabApiUrl + "/videos/" + job->token);
+  updateMetaUrl.setQuery(QUrlQuery{{"purge", ""}});
+  QJsonObject videoMetaJson;
+  videoMetaJson["original_name"] = job->videoFileName;
+  videoMetaJson["original_size"] = job->videoSize;
+  videoMetaJson["title"] = job->videoTitle.isEmpty()
+                               ? QFileInfo(*videoFile).baseName()
+                               : job->videoTitle;
+  videoMetaJson["upload_source"] = "web";
+  QNetworkRequest updateMetaReq = request(updateMetaUrl);
+  updateMetaReq.setHeader(QNetworkRequest::ContentTypeHeader,
+                          "application/json");
+  QNetworkReply *updateMetaResp = m_nam->put(
+      updateMetaReq,
+      QJsonDocument(videoMetaJson).toJson(QJsonDocument::Compact));
+  trackTask(videoFile, updateMetaResp);
+  traceReply(videoFile, MediaHost::Streamable, UploadPhase::Metadata,
+             updateMetaResp);
+  connect(updateMetaResp, &QNetworkReply::finished, this,
+          [this, jobId = job->id, updateMetaResp, uploadMode, videoFile]() {
+            UploadJob *job = liveJob(videoFile, jobId);
+
+            if (job == nullptr)
+              return;
+
+            if (updateMetaResp->error() != QNetworkReply::NoError) {
+              if (retryPhase(job, updateMetaResp, [this, job, uploadMode]() {
+                    sabUpdateMetadata(job, uploadMode);
+                  }))
+                return;
+
+              emit this->mediaUploadError(videoFile,
+                                          updateMetaResp->errorString());
+              return;
+            }
+
+            journalRecord(
+                videoFile, MediaHost::Streamable,
+                QJsonObject{{"phase", "body"},
+                            {"shortCode", job->token},
+                            {"accessKeyId", job->accessKeyId},
+                            {"secretAccessKey", job->secretAccessKey},
+                            {"sessionToken", job->sessionToken},
+                            {"transcoderToken", job->transcoderToken},
+                            {"awsRegion", job->awsRegion}});
+            sabUploadBody(job, uploadMode);
+          });
+  connect(updateMetaResp, &QNetworkReply::finished, updateMetaResp,
+          &QNetworkReply::deleteLater);
+}
+
+void MediaService::sabUploadBody(UploadJob *job,
+                                 StreamableUploadMode uploadMode) {
+  if (uploadMode == StreamableUploadMode::Multipart) {
+    sabUploadMultipart(job);
+    return;
+  }
+
+  if (uploadMode == StreamableUploadMode::StreamingPayload) {
+    sabUploadStreaming(job);
+    return;
+  }
+
+  // The hash started with the upload, so this span is only the time the
+  // body still had to wait for it
+  QFile *videoFile = job->videoFile;
+  qint64 hashWaitStart = QDateTime::currentMSecsSinceEpoch();
+  job->phase = UploadPhase::Hash;
+  QFutureWatcher<QByteArray> *payloadHashWatcher =
+      new QFutureWatcher<QByteArray>(this);
+  connect(payloadHashWatcher, &QFutureWatcher<QByteArray>::finished, this,
+          [this, hashWaitStart, jobId = job->id, payloadHashWatcher,
+           videoFile]() {
+            m_uploadTasks.remove(videoFile, payloadHashWatcher);
+            payloadHashWatcher->deleteLater();
+            UploadJob *job = liveJob(videoFile, jobId);
+
+            if (job == nullptr)
+              return;
+
+            QByteArray payloadDigest = payloadHashWatcher->result();
+            job->payloadHash = QFuture<QByteArray>();
+
+            UploadSpan hashSpan = phaseSpan(
+                MediaHost::Streamable, UploadPhase::Hash, hashWaitStart);
+            hashSpan.bytesSent = videoFile->size();
+
+            if (payloadDigest.isEmpty()) {
+              hashSpan.error = "Failed to read file for hashing!";
+              traceSpan(videoFile, hashSpan);
+              emit this->mediaUploadError(videoFile,
+                                          "Failed to read file for hashing!");
+              return;
+            }
+
+            traceSpan(videoFile, hashSpan);
+            sabUploadSigned(job, payloadDigest);
+          });
+  trackTask(videoFile, payloadHashWatcher);
+  payloadHashWatcher->setFuture(job->payloadHash);
+}
+
+void MediaService::sabUploadMultipart(UploadJob *job) {
+  QFile *videoFile = job->videoFile;
+  S3MultipartUpload *multipartUpload = new S3MultipartUpload(
+      m_nam, QUrl(m_sabAwsUrl + "/upload/" + job->token), videoFile->fileName(),
+      videoFile->size(), job->signer(), job->sessionToken, this);
+  multipartUpload->setHttp2Allowed(m_http2Allowed);
+  multipartUpload->setMaxConcurrentParts(m_sabMaxConcurrentParts);
+  multipartUpload->setMaxPartRetries(m_sabMaxPartRetries);
+  multipartUpload->setPartSize(m_sabPartSize);
+  multipartUpload->setRateLimiter(m_rateLimiter, MediaHost::Streamable);
+  multipartUpload->setKeepOnFailure(m_journal.isOpen());
+  trackTask(videoFile, multipartUpload);
+  qint64 bodyStart = QDateTime::currentMSecsSinceEpoch();
+  job->ownsFile = true;
+  job->phase = UploadPhase::Body;
+
+  // Continue a journaled upload from its last confirmed part
+  QJsonObject journalJob = m_journal.job(m_journalKeys.value(videoFile));
+
+  if (journalJob.contains("uploadId")) {
+    QMap<int, QByteArray> partETags;
+    QJsonObject parts = journalJob["parts"].toObject();
+
+    for (auto it = parts.constBegin(); it != parts.constEnd(); ++it)
+      partETags.insert(it.key().toInt(), it.value().toString().toUtf8());
+
+    multipartUpload->setPartSize(journalJob["partSize"].toInteger());
+    multipartUpload->setResumeState(journalJob["uploadId"].toString(),
+                                    partETags);
+  }
+
+  connect(multipartUpload, &S3MultipartUpload::created, this,
+          [this, videoFile](const QString &uploadId) {
+            journalRecord(videoFile, MediaHost::Streamable,
+                          QJsonObject{{"uploadId", uploadId},
+                                      {"partSize", m_sabPartSize},
+                                      {"parts", QJsonObject()}});
+          });
+  connect(multipartUpload, &S3MultipartUpload::partUploaded, this,
+          [this, videoFile](int partNumber, const QByteArray &eTag,
+                            qint64 bytesUploaded) {
+            QJsonObject parts =
+                m_journal.job(m_journalKeys.value(videoFile))["parts"]
+                    .toObject();
+            parts[QString::number(partNumber)] = QString(eTag);
+            journalRecord(videoFile, MediaHost::Streamable,
+                          QJsonObject{{"parts", parts},
+                                      {"bytesConfirmed", bytesUploaded}});
+          });
+
+  connect(multipartUpload, &S3MultipartUpload::uploadProgress, this,
+          [this, videoFile](qint64 bytesSent, qint64 bytesTotal) {
+            reportProgress(videoFile, bytesSent, bytesTotal);
+          });
+  connect(multipartUpload, &S3MultipartUpload::failed, this,
+          [this, bodyStart, multipartUpload, videoFile](const QString &error) {
+            UploadSpan bodySpan =
+                phaseSpan(MediaHost::Streamable, UploadPhase::Body, bodyStart);
+            bodySpan.bytesSent = multipartUpload->bytesSent();
+            bodySpan.retries = multipartUpload->retries();
+            bodySpan.error = error;
+            traceSpan(videoFile, bodySpan);
+            emit this->mediaUploadError(videoFile, error);
+          });
+  connect(multipartUpload, &S3MultipartUpload::finished, this,
+          [this, bodyStart, jobId = job->id, multipartUpload, videoFile]() {
+            UploadJob *job = liveJob(videoFile, jobId);
+
+            if (job == nullptr)
+              return;
+
+            UploadSpan bodySpan =
+                phaseSpan(MediaHost::Streamable, UploadPhase::Body, bodyStart);
+            bodySpan.bytesSent = multipartUpload->bytesSent();
+            bodySpan.retries = multipartUpload->retries();
+            traceSpan(videoFile, bodySpan);
+            journalRecord(videoFile, MediaHost::Streamable,
+                          QJsonObject{{"phase", "transcode"},
+                                      {"bytesConfirmed", job->videoSize}});
+            sabTranscode(job);
+          });
+  connect(multipartUpload, &S3MultipartUpload::failed, multipartUpload,
+          &S3MultipartUpload::deleteLater);
+  connect(multipartUpload, &S3MultipartUpload::finished, multipartUpload,
+          &S3MultipartUpload::deleteLater);
+  multipartUpload->start();
+}
+
+QNetworkRequest MediaService::sabUploadRequest(const UploadJob *job) const {
+  QNetworkRequest uploadReq =
+      request(QUrl(m_sabAwsUrl + "/upload/" + job->token));
+  uploadReq.setHeader(QNetworkRequest::ContentTypeHeader,
+                      "application/octet-stream");
+  uploadReq.setRawHeader("x-amz-security-token", job->sessionToken.toUtf8());
+  uploadReq.setRawHeader("x-amz-acl", "public-read");
+  return uploadReq;
+}
+
+void MediaService::sabUploadSigned(UploadJob *job,
+                                   const QByteArray &payloadDigest) {
+  QNetworkRequest uploadReq = sabUploadRequest(job);
+  job->signer().sign(uploadReq, "PUT", payloadDigest.toHex());
+  QIODevice *body = openBody(job);
+  QNetworkReply *uploadResp = sendBody(
+      MediaHost::Streamable, QNetworkAccessManager::PutOperation, uploadReq,
+      body);
+
+  if (body != job->videoFile)
+    body->setParent(uploadResp);
+
+  // The digest is kept for a resend, the file has not changed since
+  sabWatchUpload(uploadResp, job, [this, job, payloadDigest]() {
+    sabUploadSigned(job, payloadDigest);
+  });
+}
+
+void MediaService::sabUploadStreaming(UploadJob *job) {
+  QFile *videoFile = job->videoFile;
+  QNetworkRequest uploadReq = sabUploadRequest(job);
+  uploadReq.setRawHeader("Content-Encoding", "aws-chunked");
+  uploadReq.setRawHeader("x-amz-decoded-content-length",
+                         QByteArray::number(videoFile->size()));
+  uploadReq.setHeader(QNetworkRequest::ContentLengthHeader,
+                      AwsChunkedDevice::encodedSize(videoFile->size()));
+
+  AwsSigV4 signer = job->signer();
+  QDateTime reqTime = QDateTime::currentDateTimeUtc();
+  QByteArray seedSignature =
+      signer.sign(uploadReq, "PUT", AwsSigV4::streamingPayload, reqTime);
+
+  QIODevice *body = openBody(job);
+  AwsChunkedDevice *chunkedBody = new AwsChunkedDevice(
+      body, videoFile->size(), signer, reqTime, seedSignature);
+  chunkedBody->open(QIODevice::ReadOnly);
+
+  if (body != videoFile)
+    body->setParent(chunkedBody);
+
+  QNetworkReply *uploadResp =
+      sendBody(MediaHost::Streamable, QNetworkAccessManager::PutOperation,
+               uploadReq, chunkedBody);
+  chunkedBody->setParent(uploadResp);
+  sabWatchUpload(uploadResp, job, [this, job]() { sabUploadStreaming(job); });
+}
+
+// A body that fails is sent again through resend, which signs a new request
+void MediaService::sabWatchUpload(QNetworkReply *uploadResp, UploadJob *job,
+                                  const std::function<void()> &resend) {
+  QFile *videoFile = job->videoFile;
+  trackTask(videoFile, uploadResp);
+  traceReply(videoFile, MediaHost::Streamable, UploadPhase::Body, uploadResp);
+  connect(uploadResp, &QNetworkReply::uploadProgress, this,
+          [this, videoFile](qint64 bytesSent, qint64 bytesTotal) {
+            reportProgress(videoFile, bytesSent, bytesTotal);
+          });
+  connect(uploadResp, &QNetworkReply::finished, this,
+          [this, jobId = job->id, resend, uploadResp, videoFile]() {
+            UploadJob *job = liveJob(videoFile, jobId);
+
+            if (job == nullptr)
+              return;
+
+            if (uploadResp->error() != QNetworkReply::NoError) {
+              if (retryPhase(job, uploadResp, resend))
+                return;
+
+              emit this->mediaUploadError(videoFile,
+                                          uploadResp->errorString());
+              return;
+            }
+
+            journalRecord(videoFile, MediaHost::Streamable,
+                          QJsonObject{{"phase", "transcode"},
+                                      {"bytesConfirmed", job->videoSize}});
+            sabTranscode(job);
+          });
+  connect(uploadResp, &QNetworkReply::finished, uploadResp,
+          &QNetworkReply::deleteLater);
+}
+
+// Every upload body is read through the rate limiter, which passes it
+// through untouched unless a global or per-host rate is set
+QNetworkReply *
+MediaService::sendBody(MediaHost host,
+                       QNetworkAccessManager::Operation operation,
+                       QNetworkRequest req, QIODevice *body) {
+  RateLimitedDevice *limitedBody =
+      new RateLimitedDevice(body, m_rateLimiter, host);
+  limitedBody->open(QIODevice::ReadOnly);
+
+  if (!req.header(QNetworkRequest::ContentLengthHeader).isValid())
+    req.setHeader(QNetworkRequest::ContentLengthHeader, limitedBody->size());
+
+  QNetworkReply *reply = operation == QNetworkAccessManager::PutOperation
+                             ? m_nam->put(req, limitedBody)
+                             : m_nam->post(req, limitedBody);
+  limitedBody->setParent(reply);
+  return reply;
+}
+
+void MediaService::setHttp2Allowed(bool http2Allowed) {
+  m_http2Allowed = http2Allowed;
+  m_imgurPoller->setHttp2Allowed(http2Allowed);
+}
+
+// Per service, so every shard of a ShardedMediaService is pointed at its
+// endpoints from its own thread through configure()
+void MediaService::setEndpoint(Endpoint endpoint, const QString &baseUrl) {
+  switch (endpoint) {
+  case Endpoint::Dubz:
+    m_dubzUrl = baseUrl;
+    break;
+
+  case Endpoint::ImgurApi:
+    m_imgurApiUrl = baseUrl;
+    break;
+
+  case Endpoint::ImgurBase:
+    m_imgurBaseUrl = baseUrl;
+    break;
+
+  case Endpoint::JustStreamLiveApi:
+    m_jslApiUrl = baseUrl;
+    break;
+
+  case Endpoint::JustStreamLiveBase:
+    m_jslBaseUrl = baseUrl;
+    break;
+
+  case Endpoint::StreamableApi:
+    m_sabApiUrl = baseUrl;
+    break;
+
+  case Endpoint::StreamableAws:
+    m_sabAwsUrl = baseUrl;
+    break;
+
+  case Endpoint::StreamableBase:
+    m_sabBaseUrl = baseUrl;
+    break;
+
+  case Endpoint::Streamff:
+    m_sffBaseUrl = baseUrl;
+    break;
+
+  case Endpoint::Streamja:
+    m_sjaBaseUrl = baseUrl;
+    break;
+  }
+}
+
+// Shared by every MediaService, file digests are cached process-wide. The
+// cache is locked, so shards may set it from their own threads.
+void MediaService::setHashCachePath(const QString &cachePath, int maxEntries) {
+  FileDigest::setCachePath(cachePath, maxEntries);
+}
+
+void MediaService::setHostRateLimit(MediaHost host, qint64 bytesPerSecond) {
+  m_rateLimiter->setHostRate(host, bytesPerSecond);
+}
+
+bool MediaService::setUploadCache(const QString &cachePath, int maxAge,
+                                  int maxEntries) {
+  m_cacheDigests.clear();
+  m_cacheKeys.clear();
+  m_contentDigests.clear();
+
+  if (cachePath.isEmpty()) {
+    m_cache.close();
+    return true;
+  }
+
+  return m_cache.open(cachePath, maxAge, maxEntries);
+}
+
+bool MediaService::setJournalPath(const QString &journalPath) {
+  m_journalKeys.clear();
+
+  if (journalPath.isEmpty()) {
+    m_journal.close();
+    return true;
+  }
+
+  return m_journal.open(journalPath);
+}
+
+void MediaService::setProgressInterval(int interval) {
+  m_progress.setInterval(interval);
+}
+
+// The ring is filled from this object's thread and must outlive its use here;
+// pass nullptr to stop publishing to it
+void MediaService::setProgressRing(ProgressRing *progressRing) {
+  m_progressRing = progressRing;
+}
+
+void MediaService::setRateLimit(qint64 bytesPerSecond) {
+  m_rateLimiter->setRate(bytesPerSecond);
+}
+
+// Imgur's batched poll is retried by its poller under the Imgur poll rule
+void MediaService::setRetryPolicy(const RetryPolicy &retryPolicy) {
+  m_retryPolicy = retryPolicy;
+  m_imgurPoller->setRetryRule(
+      m_retryPolicy.rule(MediaHost::Imgur, UploadPhase::Poll));
+}
+
+void MediaService::setStreamableMultipartOptions(qint64 partSize,
+                                                 int maxConcurrentParts,
+                                                 int maxPartRetries) {
+  m_sabMaxConcurrentParts = maxConcurrentParts;
+  m_sabMaxPartRetries = maxPartRetries;
+  m_sabPartSize = partSize;
+}
+
+void MediaService::setStreamableUploadMode(StreamableUploadMode uploadMode) {
+  m_streamableUploadMode = uploadMode;
+}
+
+void MediaService::setTokenPoolTarget(MediaHost host, int targetSize,
+                                      int tokenLifetime) {
+  m_tokenPool->setTarget(host, targetSize, tokenLifetime);
+}
+
+void MediaService::sffUploadVideo(UploadJob *job) {
+  QFile *videoFile = job->videoFile;
+  journalRecord(videoFile, MediaHost::Streamff,
+                QJsonObject{{"phase", "body"}, {"token", job->token}});
+
+  FormDataDevice *uploadForm = bodyForm(job, "file");
+
+  QNetworkReply *uploadResp = postForm(
+      MediaHost::Streamff,
+      request(QUrl(m_sffBaseUrl + "/api/videos/upload/" + job->token)),
+      uploadForm);
+  trackTask(videoFile, uploadResp);
+  traceReply(videoFile, MediaHost::Streamff, UploadPhase::Body, uploadResp);
+  connect(uploadResp, &QNetworkReply::uploadProgress, this,
+          [this, videoFile](qint64 bytesSent, qint64 bytesTotal) {
+            reportProgress(videoFile, bytesSent, bytesTotal);
+          });
+  connect(uploadResp, &QNetworkReply::finished, this,
+          [this, jobId = job->id, uploadResp, videoFile]() {
+            UploadJob *job = liveJob(videoFile, jobId);
+
+            if (job == nullptr)
+              return;
+
+            if (uploadResp->error() != QNetworkReply::NoError) {
+              if (retryPhase(job, uploadResp,
+                             [this, job]() { sffUploadVideo(job); }))
+                return;
+
+              emit this->mediaUploadError(videoFile,
+                                          uploadResp->errorString());
+              return;
+            }
+
+            // The job is released while the signal is delivered
+            QString videoId = job->token;
+            emit this->mediaUploaded(videoFile, videoId,
+                                     m_sffBaseUrl + "/v/" + videoId);
+          });
+  connect(uploadResp, &QNetworkReply::finished, uploadResp,
+          &QNetworkReply::deleteLater);
+}
+
+void MediaService::sjaUploadVideo(UploadJob *job) {
+  QFile *videoFile = job->videoFile;
+  journalRecord(videoFile, MediaHost::Streamja,
+                QJsonObject{{"phase", "body"}, {"token", job->token}});
+
+  FormDataDevice *uploadForm = bodyForm(job, "file");
+
+  QUrl uploadUrl(m_sjaBaseUrl + "/upload.php");
+  QUrlQuery uploadQuery{{"shortId", job->token}};
+  uploadUrl.setQuery(uploadQuery);
+
+  QNetworkReply *uploadResp =
+      postForm(MediaHost::Streamja, request(uploadUrl), uploadForm);
+  trackTask(videoFile, uploadResp);
+  traceReply(videoFile, MediaHost::Streamja, UploadPhase::Body, uploadResp);
+  connect(uploadResp, &QNetworkReply::uploadProgress, this,
+          [this, videoFile](qint64 bytesSent, qint64 bytesTotal) {
+            reportProgress(videoFile, bytesSent, bytesTotal);
+          });
+  connect(uploadResp, &QNetworkReply::finished, this,
+          [this, jobId = job->id, uploadResp, videoFile]() {
+            UploadJob *job = liveJob(videoFile, jobId);
+
+            if (job == nullptr)
+              return;
+
+            if (uploadResp->error() != QNetworkReply::NoError) {
+              if (retryPhase(job, uploadResp,
+                             [this, job]() { sjaUploadVideo(job); }))
+                return;
+
+              emit this->mediaUploadError(videoFile,
+                                          uploadResp->errorString());
+              return;
+            }
+
+            // The job is released while the signal is delivered
+            QString shortId = job->token;
+            emit this->mediaUploaded(videoFile, shortId,
+                                     m_sjaBaseUrl + "/" + shortId);
+          });
+  connect(uploadResp, &QNetworkReply::finished, uploadResp,
+          &QNetworkReply::deleteLater);
+}
+
+// Takes the file's tasks out of the task list and cuts them off from this
+// service before stopping them, so an aborted reply's finished handlers never
+// run and report nothing. Replies and multipart uploads still clean up after
+// themselves through their own connections. Returns whether anything was
+// running.
+bool MediaService::stopTasks(QFile *videoFile) {
+  QList<QObject *> tasks = m_uploadTasks.values(videoFile);
+  m_uploadTasks.remove(videoFile);
+  bool stopped = !tasks.isEmpty();
+
+  for (auto it = m_imgurTickets.begin(); it != m_imgurTickets.end();) {
+    if (it->videoFile != videoFile) {
+      ++it;
+      continue;
+    }
+
+    m_imgurPoller->removeTicket(it.key());
+    it = m_imgurTickets.erase(it);
+    stopped = true;
+  }
+
+  for (auto &&task : tasks) {
+    disconnect(task, nullptr, this, nullptr);
+
+    if (QNetworkReply *reply = qobject_cast<QNetworkReply *>(task)) {
+      m_linkIdScanners.remove(reply);
+      reply->abort();
+    }
+
+    else if (S3MultipartUpload *multipartUpload =
+                 qobject_cast<S3MultipartUpload *>(task))
+      multipartUpload->cancel();
+
+    else
+      task->deleteLater();
+  }
+
+  return stopped;
+}
+
+// A file already being uploaded keeps its job, which happens when the cache
+// lookup hands a miss back to the upload slot
+UploadJob *MediaService::startJob(MediaHost host, QFile *videoFile,
+                                  const QString &videoMimeType) {
+  UploadJob *&job = m_jobs[videoFile];
+
+  if (job == nullptr) {
+    job = m_jobPool.acquire();
+    job->host = host;
+    job->startTime = QDateTime::currentMSecsSinceEpoch();
+    job->videoFile = videoFile;
+    job->videoFileName = QFileInfo(*videoFile).fileName();
+    job->videoSize = videoFile->size();
+  }
+
+  job->videoMimeType = videoMimeType;
+  return job;
+}
+
+double MediaService::throughput() const { return m_progress.throughput(); }
+
+void MediaService::traceReply(QFile *videoFile, MediaHost host,
+                              UploadPhase phase, QNetworkReply *reply) {
+  UploadJob *job = m_jobs.value(videoFile);
+
+  // Attempts count the requests sent for the phase the job is in
+  if (job != nullptr && job->phase != phase) {
+    job->phase = phase;
+    job->attempts = 0;
+  }
+
+  if (job != nullptr)
+    job->attempts++;
+
+  QSharedPointer<UploadSpan> span(new UploadSpan(
+      phaseSpan(host, phase, QDateTime::currentMSecsSinceEpoch())));
+
+  // A reply that never starts connecting a socket went out on a pooled
+  // connection
+  span->connectionReused = true;
+  span->retries = job != nullptr ? job->attempts - 1 : 0;
+  connect(reply, &QNetworkReply::socketStartedConnecting, this,
+          [span]() { span->connectionReused = false; });
+  connect(reply, &QNetworkReply::uploadProgress, this,
+          [span](qint64 bytesSent) { span->bytesSent = bytesSent; });
+  connect(reply, &QNetworkReply::downloadProgress, this,
+          [span](qint64 bytesReceived) {
+            span->bytesReceived = bytesReceived;
+          });
+  connect(reply, &QNetworkReply::finished, this,
+          [this, reply, span, videoFile]() {
+            span->endTime = QDateTime::currentMSecsSinceEpoch();
+            span->httpStatus =
+                reply->attribute(QNetworkRequest::HttpStatusCodeAttribute)
+                    .toInt();
+
+            // The Dubz home page is aborted on purpose once the link ID is
+            // found
+            if (reply->error() != QNetworkReply::NoError &&
+                !m_linkIdScanners.value(reply).isFound())
+              span->error = reply->errorString();
+
+            traceSpan(videoFile, *span);
+          });
+}
+
+void MediaService::traceSpan(QFile *videoFile, const UploadSpan &span) {
+  m_metrics.record(span);
+  emit this->uploadSpan(videoFile, span);
+}
+
+void MediaService::trackTask(QFile *videoFile, QObject *task) {
+  m_uploadTasks.insert(videoFile, task);
+  connect(task, &QObject::destroyed, this,
+          [this, task, videoFile]() { m_uploadTasks.remove(videoFile, task); });
+}
+
+void MediaService::upload(MediaHost host, QFile *videoFile,
+                          const QString &videoTitle,
+                          const QString &awsRegion) {
+  switch (host) {
+  case MediaHost::Dubz:
+    uploadDubz(videoFile, videoTitle);
+    break;
+
+  case MediaHost::Imgur:
+    uploadImgur(videoFile, videoTitle);
+    break;
+
+  case MediaHost::JustStreamLive:
+    uploadJustStreamLive(videoFile);
+    break;
+
+  case MediaHost::Streamable:
+    uploadStreamable(videoFile, videoTitle, awsRegion);
+    break;
+
+  case MediaHost::Streamff:
+    uploadStreamff(videoFile);
+    break;
+
+  case MediaHost::Streamja:
+    uploadStreamja(videoFile);
+    break;
+  }
+}
+
+// The batch starts from the event loop, after the caller had a chance to
+// connect to it, and deletes itself once it has reported finished
+UploadBatch *MediaService::uploadBatch(const QList<QFile *> &videoFiles,
+                                       MediaHost host,
+                                       const UploadBatch::Options &options) {
+  UploadBatch *batch = new UploadBatch(this, host, videoFiles, options, this);
+  connect(batch, &UploadBatch::finished, batch, &UploadBatch::deleteLater);
+  QMetaObject::invokeMethod(batch, &UploadBatch::start, Qt::QueuedConnection);
+  return batch;
+}
+
+QFuture<UploadResult> MediaService::uploadAsync(MediaHost host,
+                                               QFile *videoFile,
+                                               const QString &videoTitle,
+                                               const QString &awsRegion) {
+  if (m_uploadResults.contains(videoFile))
+    return m_uploadResults.value(videoFile).promise->future();
+
+  QSharedPointer<QPromise<UploadResult>> promise(
+      new QPromise<UploadResult>());
+  promise->start();
+
+  // A file already uploading through upload() shares its job, so the
+  // future joins that upload rather than starting a second one
+  if (UploadJob *job = m_jobs.value(videoFile)) {
+    m_uploadResults.insert(videoFile, PendingResult{job->host, promise});
+    return promise->future();
+  }
+
+  m_uploadResults.insert(videoFile, PendingResult{host, promise});
+  upload(host, videoFile, videoTitle, awsRegion);
+  return promise->future();
+}
+
+void MediaService::uploadDubz(QFile *videoFile, const QString &videoTitle) {
+  UploadPreflight::Result preflight =
+      UploadPreflight::check(MediaHost::Dubz, videoFile->fileName());
+
+  if (!preflight.error.isEmpty()) {
+    emit this->mediaUploadError(videoFile, preflight.error);
+    return;
+  }
+
+  UploadJob *job = startJob(MediaHost::Dubz, videoFile, preflight.mimeType);
+  job->videoTitle = videoTitle;
+
+  if (cacheLookup(job))
+    return;
+
+  if (journalResume(job))
+    return;
+
+  job->token = m_tokenPool->take(MediaHost::Dubz);
+
+  if (!job->token.isEmpty()) {
+    dubzUploadVideo(job);
+    return;
+  }
+
+  requestJobToken(job);
+}
+
+void MediaService::uploadFanOut(QFile *videoFile, const QList<MediaHost> &hosts,
+                                const QString &videoTitle,
+                                const QString &awsRegion) {
+  QSharedPointer<SharedFileReader> reader(
+      new SharedFileReader(videoFile->fileName()));
+
+  if (!reader->open()) {
+    m_races.remove(videoFile);
+    emit this->mediaUploadError(videoFile, reader->errorString());
+    return;
+  }
+
+  QMap<MediaHost, QFile *> hostFiles;
+
+  for (auto &&host : hosts) {
+    if (hostFiles.contains(host))
+      continue;
+
+    // Each host gets its own handle since the upload paths reparent and
+    // delete the file they are given
+    QFile *hostFile = new QFile(videoFile->fileName(), videoFile);
+    m_fanOutHandles.insert(hostFile,
+                           FanOutHandle{host, reader, videoFile, false});
+    hostFiles.insert(host, hostFile);
+  }
+
+  if (hostFiles.isEmpty()) {
+    m_races.remove(videoFile);
+    emit this->mediaUploadError(videoFile, "No hosts to upload to!");
+    return;
+  }
+
+  // A host answered from the upload cache may win a race while the others
+  // are still being started; those were released by the win
+  for (auto it = hostFiles.cbegin(); it != hostFiles.cend(); ++it) {
+    auto handle = m_fanOutHandles.find(it.value());
+
+    if (handle == m_fanOutHandles.end())
+      continue;
+
+    handle->started = true;
+    upload(it.key(), it.value(), videoTitle, awsRegion);
+  }
+}
+
+void MediaService::uploadImgur(QFile *videoFile, const QString &videoTitle) {
+  UploadPreflight::Result preflight =
+      UploadPreflight::check(MediaHost::Imgur, videoFile->fileName());
+
+  if (!preflight.error.isEmpty()) {
+    emit this->mediaUploadError(videoFile, preflight.error);
+    return;
+  }
+
+  UploadJob *job = startJob(MediaHost::Imgur, videoFile, preflight.mimeType);
+  job->videoTitle = videoTitle;
+
+  if (cacheLookup(job))
+    return;
+
+  if (journalResume(job))
+    return;
+
+  imgurCheckCaptcha(job);
+}
+
+void MediaService::uploadJustStreamLive(QFile *videoFile) {
+  UploadPreflight::Result preflight =
+      UploadPreflight::check(MediaHost::JustStreamLive, videoFile->fileName());
+
+  if (!preflight.error.isEmpty()) {
+    emit this->mediaUploadError(videoFile, preflight.error);
+    return;
+  }
+
+  UploadJob *job =
+      startJob(MediaHost::JustStreamLive, videoFile, preflight.mimeType);
+
+  if (cacheLookup(job))
+    return;
+
+  jslUploadVideo(job);
+}
+
+void MediaService::uploadRace(QFile *videoFile, const QList<MediaHost> &hosts,
+                              const QString &videoTitle,
+                              const QString &awsRegion) {
+  Race race{QElapsedTimer(), QMap<MediaHost, qint64>(), false, false,
+            MediaHost::Dubz};
+  race.timer.start();
+  m_races.insert(videoFile, race);
+  uploadFanOut(videoFile, hosts, videoTitle, awsRegion);
+}
+
+void MediaService::uploadStreamable(QFile *videoFile, const QString &videoTitle,
+                                    const QString &awsRegion) {
+  UploadPreflight::Result preflight =
+      UploadPreflight::check(MediaHost::Streamable, videoFile->fileName());
+
+  if (!preflight.error.isEmpty()) {
+    emit this->mediaUploadError(videoFile, preflight.error);
+    return;
+  }
+
+  UploadJob *job =
+      startJob(MediaHost::Streamable, videoFile, preflight.mimeType);
+  job->videoTitle = videoTitle;
+  job->awsRegion = awsRegion;
+
+  if (cacheLookup(job))
+    return;
+
+  if (journalResume(job))
+    return;
+
+  StreamableUploadMode uploadMode = m_streamableUploadMode;
+
+  // The cache lookup may already be hashing the file
+  if (uploadMode == StreamableUploadMode::SignedPayload &&
+      !job->payloadHash.isValid())
+    job->payloadHash = payloadHash(videoFile);
+
+  // Open the S3 connection now so its handshake overlaps the shortcode and
+  // metadata round trips
+  m_tokenPool->preconnect(MediaHost::Streamable);
+  sabRequestShortcode(job, uploadMode);
+}
+
+void MediaService::uploadStreamff(QFile *videoFile) {
+  UploadPreflight::Result preflight =
+      UploadPreflight::check(MediaHost::Streamff, videoFile->fileName());
+
+  if (!preflight.error.isEmpty()) {
+    emit this->mediaUploadError(videoFile, preflight.error);
+    return;
+  }
+
+  UploadJob *job = startJob(MediaHost::Streamff, videoFile, preflight.mimeType);
+
+  if (cacheLookup(job))
+    return;
+
+  if (journalResume(job))
+    return;
+
+  job->token = m_tokenPool->take(MediaHost::Streamff);
+
+  if (!job->token.isEmpty()) {
+    sffUploadVideo(job);
+    return;
+  }
+
+  requestJobToken(job);
+}
+
+void MediaService::uploadStreamja(QFile *videoFile) {
+  UploadPreflight::Result preflight =
+      UploadPreflight::check(MediaHost::Streamja, videoFile->fileName());
+
+  if (!preflight.error.isEmpty()) {
+    emit this->mediaUploadError(videoFile, preflight.error);
+    return;
+  }
+
+  UploadJob *job = startJob(MediaHost::Streamja, videoFile, preflight.mimeType);
+
+  if (cacheLookup(job))
+    return;
+
+  if (journalResume(job))
+    return;
+
+  job->token = m_tokenPool->take(MediaHost::Streamja);
+
+  if (!job->token.isEmpty()) {
+    sjaUploadVideo(job);
+    return;
+  }
+
+  requestJobToken(job);
+}
+
+UploadPhase MediaService::uploadPhase(QFile *videoFile) const {
+  UploadJob *job = m_jobs.value(videoFile);
+  return job != nullptr ? job->phase : UploadPhase::Idle;
+}
+
+UploadJob::Status MediaService::uploadStatus(QFile *videoFile) const {
+  UploadJob *job = m_jobs.value(videoFile);
+  return job != nullptr ? job->status : UploadJob::Status::Idle;
+}
+
+// Token from a finished requestUploadToken() reply, or an empty string if the
+// request failed or no token was found. A Dubz home page cut short after its
+// link ID was found still has it.
+QString MediaService::uploadToken(MediaHost host, QNetworkReply *tokenResp) {
+  auto linkIdScanner = m_linkIdScanners.find(tokenResp);
+
+  if (host == MediaHost::Dubz && linkIdScanner != m_linkIdScanners.end()) {
+    if (!linkIdScanner->isFound() &&
+        tokenResp->error() == QNetworkReply::NoError)
+      linkIdScanner->feed(tokenResp->readAll());
+
+    return linkIdScanner->linkId();
+  }
+
+  if (tokenResp->error() != QNetworkReply::NoError)
+    return QString();
+
+  return parseUploadToken(host, tokenResp->readAll());
+}
+
+void MediaService::warmUp() {
+  warmUp({MediaHost::Dubz, MediaHost::Imgur, MediaHost::JustStreamLive,
+          MediaHost::Streamable, MediaHost::Streamff, MediaHost::Streamja});
+}
+
+void MediaService::warmUp(const QList<MediaHost> &hosts) {
+  QSslConfiguration sslConfig = QSslConfiguration::defaultConfiguration();
+
+  // The pre-opened connection is only reused by requests with the same
+  // HTTP/2 setting, so offer the same protocols they would
+  if (m_http2Allowed)
+    sslConfig.setAllowedNextProtocols({QSslConfiguration::ALPNProtocolHTTP2,
+                                       QSslConfiguration::NextProtocolHttp1_1});
+
+  else
+    sslConfig.setAllowedNextProtocols({QSslConfiguration::NextProtocolHttp1_1});
+
+  // One connection per scheme, host and port, so endpoints redirected to a
+  // plain HTTP or non-default port server are warmed where requests go
+  QSet<QUrl> originUrls;
+
+  for (auto &&host : hosts)
+    for (auto &&hostUrl : hostUrls(host))
+      originUrls.insert(QUrl(hostUrl).adjusted(
+          QUrl::RemoveUserInfo | QUrl::RemovePath | QUrl::RemoveQuery |
+          QUrl::RemoveFragment));
+
+  for (auto &&originUrl : originUrls) {
+    if (originUrl.scheme() == "https")
+      m_nam->connectToHostEncrypted(originUrl.host(), originUrl.port(443),
+                                    sslConfig);
+
+    else
+      m_nam->connectToHost(originUrl.host(), originUrl.port(80));
+  }
+}
 } // namespace eXVHP::Service
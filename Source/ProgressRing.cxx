@@ -0,0 +1,64 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ProgressRing.hxx"
+
+namespace eXVHP::Service {
+int ProgressRing::defaultCapacity = 1024;
+
+// Capacity is rounded up to a power of two so indices wrap with a mask
+ProgressRing::ProgressRing(int capacity)
+    : m_head(0), m_tail(0), m_dropped(0) {
+  quint32 slotCount = 2;
+
+  while (slotCount < quint32(capacity))
+    slotCount *= 2;
+
+  m_mask = slotCount - 1;
+  m_slots.resize(slotCount);
+}
+
+int ProgressRing::capacity() const { return m_slots.size(); }
+
+quint32 ProgressRing::dropped() const { return m_dropped.loadRelaxed(); }
+
+// Consumer side only
+bool ProgressRing::pop(ProgressSnapshot &snapshot) {
+  quint32 tail = m_tail.loadRelaxed();
+
+  if (tail == m_head.loadAcquire())
+    return false;
+
+  snapshot = m_slots.at(tail & m_mask);
+  m_tail.storeRelease(tail + 1);
+  return true;
+}
+
+// Producer side only
+bool ProgressRing::push(const ProgressSnapshot &snapshot) {
+  quint32 head = m_head.loadRelaxed();
+
+  if (head - m_tail.loadAcquire() > m_mask) {
+    m_dropped.fetchAndAddRelaxed(1);
+    return false;
+  }
+
+  m_slots[head & m_mask] = snapshot;
+  m_head.storeRelease(head + 1);
+  return true;
+}
+} // namespace eXVHP::Service
@@ -0,0 +1,66 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "RateLimitedDevice.hxx"
+
+namespace eXVHP::Service {
+RateLimitedDevice::RateLimitedDevice(QIODevice *device,
+                                     RateLimiter *rateLimiter, MediaHost host,
+                                     QObject *parent)
+    : ReadOnlyDevice(parent), m_device(device), m_host(host),
+      m_rateLimiter(rateLimiter) {
+  connect(m_rateLimiter, &RateLimiter::tokensAvailable, this,
+          &QIODevice::readyRead);
+  connect(m_device, &QIODevice::readyRead, this, &QIODevice::readyRead);
+}
+
+bool RateLimitedDevice::isSequential() const {
+  return m_device->isSequential();
+}
+
+bool RateLimitedDevice::openSource() {
+  if (!m_device->isOpen() && !m_device->open(QIODevice::ReadOnly)) {
+    setErrorString(m_device->errorString());
+    return false;
+  }
+
+  return true;
+}
+
+qint64 RateLimitedDevice::readData(char *data, qint64 maxSize) {
+  if (!m_device->isSequential())
+    maxSize = qMin(maxSize, m_device->size() - m_device->pos());
+
+  qint64 grantSize = m_rateLimiter->acquire(m_host, maxSize);
+
+  if (grantSize == 0)
+    return 0;
+
+  qint64 bytesRead = m_device->read(data, grantSize);
+
+  if (bytesRead < 0)
+    setErrorString(m_device->errorString());
+
+  return bytesRead;
+}
+
+bool RateLimitedDevice::seek(qint64 pos) {
+  return QIODevice::seek(pos) && m_device->seek(pos);
+}
+
+qint64 RateLimitedDevice::size() const { return m_device->size(); }
+} // namespace eXVHP::Service
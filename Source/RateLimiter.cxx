@@ -0,0 +1,115 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "RateLimiter.hxx"
+
+namespace eXVHP::Service {
+int RateLimiter::burstWindow = 250;
+qint64 RateLimiter::minimumGrant = 16 * 0x400;
+int RateLimiter::refillInterval = 20;
+
+RateLimiter::RateLimiter(QObject *parent) : QObject(parent) {
+  m_clock.start();
+  m_refillTimer.setInterval(refillInterval);
+  m_refillTimer.setSingleShot(true);
+  connect(&m_refillTimer, &QTimer::timeout, this,
+          &RateLimiter::tokensAvailable);
+}
+
+// Grants nothing rather than less than minimumGrant so a throttled body is
+// sent in reasonably sized reads instead of a trickle of tiny ones
+qint64 RateLimiter::acquire(MediaHost host, qint64 maxSize) {
+  qint64 grantSize = maxSize;
+  refill(m_globalBucket);
+
+  if (m_globalBucket.rate > 0)
+    grantSize = qMin(grantSize, qint64(m_globalBucket.tokens));
+
+  auto hostBucket = m_hostBuckets.find(host);
+
+  if (hostBucket != m_hostBuckets.end()) {
+    refill(*hostBucket);
+    grantSize = qMin(grantSize, qint64(hostBucket->tokens));
+  }
+
+  if (grantSize < qMin(maxSize, minimumGrant)) {
+    if (!m_refillTimer.isActive())
+      m_refillTimer.start();
+
+    return 0;
+  }
+
+  if (m_globalBucket.rate > 0)
+    m_globalBucket.tokens -= grantSize;
+
+  if (hostBucket != m_hostBuckets.end())
+    hostBucket->tokens -= grantSize;
+
+  return grantSize;
+}
+
+qint64 RateLimiter::capacity(qint64 rate) {
+  return qMax(minimumGrant, rate * burstWindow / 1000);
+}
+
+qint64 RateLimiter::hostRate(MediaHost host) const {
+  auto hostBucket = m_hostBuckets.constFind(host);
+
+  if (hostBucket == m_hostBuckets.constEnd())
+    return 0;
+
+  return hostBucket->rate;
+}
+
+qint64 RateLimiter::rate() const { return m_globalBucket.rate; }
+
+void RateLimiter::refill(Bucket &bucket) {
+  qint64 now = m_clock.elapsed();
+
+  if (bucket.rate > 0)
+    bucket.tokens =
+        qMin(double(capacity(bucket.rate)),
+             bucket.tokens + bucket.rate * (now - bucket.lastRefill) / 1000.0);
+
+  bucket.lastRefill = now;
+}
+
+// Bodies waiting on the old rate are woken up to retry with the new one
+void RateLimiter::setBucketRate(Bucket &bucket, qint64 bytesPerSecond) {
+  refill(bucket);
+  bucket.rate = qMax(qint64(0), bytesPerSecond);
+  bucket.tokens = qMin(bucket.tokens, double(capacity(bucket.rate)));
+  m_refillTimer.start();
+}
+
+void RateLimiter::setHostRate(MediaHost host, qint64 bytesPerSecond) {
+  if (bytesPerSecond <= 0) {
+    m_hostBuckets.remove(host);
+    m_refillTimer.start();
+    return;
+  }
+
+  if (!m_hostBuckets.contains(host))
+    m_hostBuckets[host].tokens = capacity(bytesPerSecond);
+
+  setBucketRate(m_hostBuckets[host], bytesPerSecond);
+}
+
+void RateLimiter::setRate(qint64 bytesPerSecond) {
+  setBucketRate(m_globalBucket, bytesPerSecond);
+}
+} // namespace eXVHP::Service
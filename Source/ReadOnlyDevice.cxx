@@ -0,0 +1,37 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ReadOnlyDevice.hxx"
+
+namespace eXVHP::Service {
+ReadOnlyDevice::ReadOnlyDevice(QObject *parent) : QIODevice(parent) {}
+
+bool ReadOnlyDevice::open(OpenMode mode) {
+  if (mode & QIODevice::WriteOnly || !openSource())
+    return false;
+
+  return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+bool ReadOnlyDevice::openSource() { return true; }
+
+qint64 ReadOnlyDevice::writeData(const char *data, qint64 maxSize) {
+  Q_UNUSED(data);
+  Q_UNUSED(maxSize);
+  return -1;
+}
+} // namespace eXVHP::Service
@@ -0,0 +1,123 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "RetryPolicy.hxx"
+#include <QRandomGenerator>
+
+namespace eXVHP::Service {
+int RetryPolicy::defaultBaseDelay = 500;
+int RetryPolicy::defaultMaxAttempts = 4;
+int RetryPolicy::defaultMaxDelay = 30000;
+
+RetryPolicy::RetryPolicy()
+    : m_defaultRule{defaultMaxAttempts, defaultBaseDelay, defaultMaxDelay} {}
+
+// Delay before the retry following the given attempt, counted from 1
+int RetryPolicy::backoff(int attempt, int baseDelay, int maxDelay) {
+  qint64 delay = qMax(1, baseDelay);
+
+  for (int i = 1; i < attempt && delay < maxDelay; i++)
+    delay *= 2;
+
+  int cappedDelay = int(qMin(delay, qint64(maxDelay)));
+  return cappedDelay / 2 +
+         QRandomGenerator::global()->bounded(cappedDelay / 2 + 1);
+}
+
+// A Retry-After header in seconds, as sent with 429 and 503, is honoured
+// when it asks for a longer wait than the backoff
+int RetryPolicy::delay(MediaHost host, UploadPhase phase, int attempt,
+                       const QNetworkReply *reply) const {
+  Rule phaseRule = rule(host, phase);
+  int retryDelay =
+      backoff(attempt, phaseRule.baseDelay, phaseRule.maxDelay);
+
+  if (reply != nullptr && reply->hasRawHeader("Retry-After")) {
+    bool isSeconds = false;
+    int retryAfter = reply->rawHeader("Retry-After").toInt(&isSeconds);
+
+    if (isSeconds)
+      retryDelay = qMax(retryDelay, qMin(retryAfter * 1000,
+                                         phaseRule.maxDelay));
+  }
+
+  return retryDelay;
+}
+
+bool RetryPolicy::isIdempotent(UploadPhase phase) {
+  return phase == UploadPhase::Token || phase == UploadPhase::Metadata ||
+         phase == UploadPhase::Poll;
+}
+
+bool RetryPolicy::isTransient(const QNetworkReply *reply) {
+  int httpStatus =
+      reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+  if (httpStatus == 408 || httpStatus == 429 || httpStatus >= 500)
+    return true;
+
+  switch (reply->error()) {
+  case QNetworkReply::ConnectionRefusedError:
+  case QNetworkReply::RemoteHostClosedError:
+  case QNetworkReply::HostNotFoundError:
+  case QNetworkReply::TimeoutError:
+  case QNetworkReply::TemporaryNetworkFailureError:
+  case QNetworkReply::NetworkSessionFailedError:
+  case QNetworkReply::UnknownNetworkError:
+  case QNetworkReply::ProxyConnectionClosedError:
+  case QNetworkReply::ProxyTimeoutError:
+  case QNetworkReply::InternalServerError:
+  case QNetworkReply::ServiceUnavailableError:
+  case QNetworkReply::UnknownServerError:
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+// No byte of the request reached the host
+bool RetryPolicy::isUnsent(const QNetworkReply *reply) {
+  return reply->error() == QNetworkReply::ConnectionRefusedError ||
+         reply->error() == QNetworkReply::HostNotFoundError;
+}
+
+RetryPolicy::Rule RetryPolicy::rule(MediaHost host, UploadPhase phase) const {
+  if (m_rules.contains(qMakePair(host, phase)))
+    return m_rules.value(qMakePair(host, phase));
+
+  if (isIdempotent(phase))
+    return m_defaultRule;
+
+  return Rule{1, m_defaultRule.baseDelay, m_defaultRule.maxDelay};
+}
+
+void RetryPolicy::setDefaultRule(const Rule &rule) { m_defaultRule = rule; }
+
+void RetryPolicy::setRule(MediaHost host, UploadPhase phase,
+                          const Rule &rule) {
+  m_rules.insert(qMakePair(host, phase), rule);
+}
+
+bool RetryPolicy::shouldRetry(MediaHost host, UploadPhase phase, int attempt,
+                              const QNetworkReply *reply) const {
+  if (m_rules.contains(qMakePair(host, phase)) || isIdempotent(phase))
+    return attempt < rule(host, phase).maxAttempts && isTransient(reply);
+
+  return attempt < m_defaultRule.maxAttempts && isUnsent(reply);
+}
+} // namespace eXVHP::Service
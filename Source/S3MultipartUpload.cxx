@@ -0,0 +1,392 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "S3MultipartUpload.hxx"
+#include "FileDigest.hxx"
+#include "FileRangeDevice.hxx"
+#include "RateLimitedDevice.hxx"
+#include "RetryPolicy.hxx"
+#include <QCryptographicHash>
+#include <QFutureWatcher>
+#include <QTimer>
+#include <QXmlStreamReader>
+
+namespace eXVHP::Service {
+int S3MultipartUpload::defaultMaxConcurrentParts = 4;
+int S3MultipartUpload::defaultMaxPartRetries = 3;
+qint64 S3MultipartUpload::defaultPartSize = 8 * 0x100000;
+qint64 S3MultipartUpload::minimumPartSize = 5 * 0x100000;
+
+S3MultipartUpload::S3MultipartUpload(QNetworkAccessManager *nam,
+                                     const QUrl &url, const QString &fileName,
+                                     qint64 fileSize, const AwsSigV4 &signer,
+                                     const QString &sessionToken,
+                                     QObject *parent)
+    : QObject(parent), m_aborted(false), m_completedParts(0),
+      m_fileName(fileName), m_fileSize(fileSize), m_http2Allowed(true),
+      m_keepOnFailure(false),
+      m_maxConcurrentParts(defaultMaxConcurrentParts),
+      m_maxPartRetries(defaultMaxPartRetries), m_nam(nam),
+      m_partSize(defaultPartSize), m_rateLimitHost(MediaHost::Streamable),
+      m_rateLimiter(nullptr), m_runningParts(0),
+      m_sessionToken(sessionToken), m_signer(signer), m_url(url) {}
+
+void S3MultipartUpload::abort(const QString &error, bool discard) {
+  if (m_aborted)
+    return;
+
+  m_aborted = true;
+  m_pendingParts.clear();
+
+  for (auto &&part : m_parts)
+    if (part.reply != nullptr)
+      part.reply->abort();
+
+  // A kept upload can be continued later with setResumeState()
+  if (!m_uploadId.isEmpty() && (discard || !m_keepOnFailure)) {
+    QNetworkRequest abortReq = request(QUrlQuery{{"uploadId", m_uploadId}});
+    m_signer.sign(abortReq, "DELETE", AwsSigV4::emptyPayloadHash);
+    QNetworkReply *abortResp = m_nam->deleteResource(abortReq);
+    connect(abortResp, &QNetworkReply::finished, abortResp,
+            &QNetworkReply::deleteLater);
+  }
+
+  emit this->failed(error);
+}
+
+qint64 S3MultipartUpload::bytesSent() const { return partBytesSent(); }
+
+void S3MultipartUpload::cancel() { abort("Upload canceled!", true); }
+
+void S3MultipartUpload::complete() {
+  QByteArray completeXml = "<CompleteMultipartUpload>";
+
+  for (int partIndex = 0; partIndex < m_parts.size(); partIndex++)
+    completeXml += "<Part><PartNumber>" + QByteArray::number(partIndex + 1) +
+                   "</PartNumber><ETag>" + m_parts[partIndex].eTag +
+                   "</ETag></Part>";
+
+  completeXml += "</CompleteMultipartUpload>";
+
+  QNetworkRequest completeReq = request(QUrlQuery{{"uploadId", m_uploadId}});
+  completeReq.setHeader(QNetworkRequest::ContentTypeHeader, "application/xml");
+  m_signer.sign(
+      completeReq, "POST",
+      QCryptographicHash::hash(completeXml, QCryptographicHash::Sha256)
+          .toHex());
+  QNetworkReply *completeResp = m_nam->post(completeReq, completeXml);
+
+  connect(completeResp, &QNetworkReply::finished, this, [this, completeResp]() {
+    if (completeResp->error() != QNetworkReply::NoError) {
+      abort(completeResp->errorString());
+      return;
+    }
+
+    // S3 can report a failed completion with a 200 status and an error body
+    QString errorMessage = parseErrorMessage(completeResp->readAll());
+
+    if (!errorMessage.isNull()) {
+      abort(errorMessage);
+      return;
+    }
+
+    emit this->finished();
+  });
+  connect(completeResp, &QNetworkReply::finished, completeResp,
+          &QNetworkReply::deleteLater);
+}
+
+void S3MultipartUpload::dispatchParts() {
+  while (!m_aborted && m_runningParts < m_maxConcurrentParts &&
+         !m_pendingParts.isEmpty())
+    uploadPart(m_pendingParts.takeFirst());
+}
+
+QString S3MultipartUpload::parseErrorMessage(const QByteArray &xmlData) {
+  QXmlStreamReader xmlReader(xmlData);
+
+  if (!xmlReader.readNextStartElement() || xmlReader.name() != "Error")
+    return QString();
+
+  QString errorCode, errorMessage;
+
+  while (xmlReader.readNextStartElement()) {
+    if (xmlReader.name() == "Code")
+      errorCode = xmlReader.readElementText();
+
+    else if (xmlReader.name() == "Message")
+      errorMessage = xmlReader.readElementText();
+
+    else
+      xmlReader.skipCurrentElement();
+  }
+
+  return errorCode + ": " + errorMessage;
+}
+
+QString S3MultipartUpload::parseUploadId(const QByteArray &xmlData) {
+  QXmlStreamReader xmlReader(xmlData);
+
+  if (!xmlReader.readNextStartElement())
+    return QString();
+
+  while (xmlReader.readNextStartElement()) {
+    if (xmlReader.name() == "UploadId")
+      return xmlReader.readElementText();
+
+    xmlReader.skipCurrentElement();
+  }
+
+  return QString();
+}
+
+qint64 S3MultipartUpload::partBytesSent() const {
+  qint64 bytesSent = 0;
+
+  for (auto &&part : m_parts)
+    bytesSent += part.bytesSent;
+
+  return bytesSent;
+}
+
+qint64 S3MultipartUpload::partBytesUploaded() const {
+  qint64 bytesUploaded = 0;
+
+  for (auto &&part : m_parts)
+    if (!part.eTag.isEmpty())
+      bytesUploaded += part.size;
+
+  return bytesUploaded;
+}
+
+QNetworkRequest S3MultipartUpload::request(const QUrlQuery &query) const {
+  QUrl reqUrl(m_url);
+  reqUrl.setQuery(query);
+  QNetworkRequest req(reqUrl);
+  req.setAttribute(QNetworkRequest::Http2AllowedAttribute, m_http2Allowed);
+  req.setRawHeader("x-amz-security-token", m_sessionToken.toUtf8());
+  return req;
+}
+
+int S3MultipartUpload::retries() const {
+  int retries = 0;
+
+  for (auto &&part : m_parts)
+    retries += qMax(0, part.attempts - 1);
+
+  return retries;
+}
+
+void S3MultipartUpload::setHttp2Allowed(bool http2Allowed) {
+  m_http2Allowed = http2Allowed;
+}
+
+void S3MultipartUpload::setKeepOnFailure(bool keepOnFailure) {
+  m_keepOnFailure = keepOnFailure;
+}
+
+void S3MultipartUpload::setMaxConcurrentParts(int maxConcurrentParts) {
+  m_maxConcurrentParts = qMax(1, maxConcurrentParts);
+}
+
+void S3MultipartUpload::setMaxPartRetries(int maxPartRetries) {
+  m_maxPartRetries = qMax(0, maxPartRetries);
+}
+
+void S3MultipartUpload::setPartSize(qint64 partSize) {
+  m_partSize = qMax(minimumPartSize, partSize);
+}
+
+void S3MultipartUpload::setRateLimiter(RateLimiter *rateLimiter,
+                                       MediaHost host) {
+  m_rateLimiter = rateLimiter;
+  m_rateLimitHost = host;
+}
+
+void S3MultipartUpload::setResumeState(const QString &uploadId,
+                                       const QMap<int, QByteArray> &partETags) {
+  m_uploadId = uploadId;
+  m_resumeETags = partETags;
+}
+
+void S3MultipartUpload::start() {
+  for (qint64 offset = 0; offset < m_fileSize; offset += m_partSize)
+    m_parts.append(Part{0, 0, QByteArray(), offset, nullptr,
+                        qMin(m_partSize, m_fileSize - offset)});
+
+  if (m_parts.isEmpty())
+    m_parts.append(Part{0, 0, QByteArray(), 0, nullptr, 0});
+
+  // Parts already uploaded to a resumed upload are not sent again
+  for (int partIndex = 0; partIndex < m_parts.size(); partIndex++) {
+    Part &part = m_parts[partIndex];
+    part.eTag = m_resumeETags.value(partIndex + 1);
+
+    if (part.eTag.isEmpty()) {
+      m_pendingParts.append(partIndex);
+      continue;
+    }
+
+    part.bytesSent = part.size;
+    m_completedParts++;
+  }
+
+  if (!m_uploadId.isEmpty()) {
+    emit this->uploadProgress(partBytesSent(), m_fileSize);
+
+    if (m_completedParts == m_parts.size())
+      complete();
+
+    else
+      dispatchParts();
+
+    return;
+  }
+
+  QNetworkRequest createReq = request(QUrlQuery{{"uploads", ""}});
+  createReq.setHeader(QNetworkRequest::ContentTypeHeader,
+                      "application/octet-stream");
+  createReq.setRawHeader("x-amz-acl", "public-read");
+  m_signer.sign(createReq, "POST", AwsSigV4::emptyPayloadHash);
+  QNetworkReply *createResp = m_nam->post(createReq, QByteArray());
+
+  connect(createResp, &QNetworkReply::finished, this, [this, createResp]() {
+    if (createResp->error() != QNetworkReply::NoError) {
+      abort(createResp->errorString());
+      return;
+    }
+
+    m_uploadId = parseUploadId(createResp->readAll());
+
+    if (m_uploadId.isEmpty()) {
+      abort("S3 did not return a multipart upload ID!");
+      return;
+    }
+
+    emit this->created(m_uploadId);
+
+    dispatchParts();
+  });
+  connect(createResp, &QNetworkReply::finished, createResp,
+          &QNetworkReply::deleteLater);
+}
+
+void S3MultipartUpload::uploadPart(int partIndex) {
+  m_runningParts++;
+  m_parts[partIndex].attempts++;
+
+  QFutureWatcher<QByteArray> *partHashWatcher =
+      new QFutureWatcher<QByteArray>(this);
+  connect(
+      partHashWatcher, &QFutureWatcher<QByteArray>::finished, this,
+      [this, partHashWatcher, partIndex]() {
+        QByteArray partDigest = partHashWatcher->result();
+        partHashWatcher->deleteLater();
+
+        if (m_aborted)
+          return;
+
+        if (partDigest.isEmpty()) {
+          abort("Failed to read file for hashing!");
+          return;
+        }
+
+        Part &part = m_parts[partIndex];
+        QNetworkRequest partReq =
+            request(QUrlQuery{{"partNumber", QString::number(partIndex + 1)},
+                              {"uploadId", m_uploadId}});
+        m_signer.sign(partReq, "PUT", partDigest.toHex());
+
+        QIODevice *partBody =
+            new FileRangeDevice(m_fileName, part.offset, part.size);
+
+        if (m_rateLimiter != nullptr) {
+          QIODevice *rangeBody = partBody;
+          partBody = new RateLimitedDevice(rangeBody, m_rateLimiter,
+                                           m_rateLimitHost);
+          rangeBody->setParent(partBody);
+        }
+
+        if (!partBody->open(QIODevice::ReadOnly)) {
+          abort(partBody->errorString());
+          delete partBody;
+          return;
+        }
+
+        QNetworkReply *partResp = m_nam->put(partReq, partBody);
+        partBody->setParent(partResp);
+        part.reply = partResp;
+
+        connect(partResp, &QNetworkReply::uploadProgress, this,
+                [this, partIndex](qint64 bytesSent, qint64 bytesTotal) {
+                  Q_UNUSED(bytesTotal);
+                  m_parts[partIndex].bytesSent = bytesSent;
+                  emit this->uploadProgress(partBytesSent(), m_fileSize);
+                });
+        connect(partResp, &QNetworkReply::finished, this,
+                [this, partIndex, partResp]() {
+                  Part &part = m_parts[partIndex];
+                  part.reply = nullptr;
+                  m_runningParts--;
+
+                  if (m_aborted)
+                    return;
+
+                  if (partResp->error() != QNetworkReply::NoError) {
+                    part.bytesSent = 0;
+
+                    if (part.attempts > m_maxPartRetries ||
+                        !RetryPolicy::isTransient(partResp)) {
+                      abort(partResp->errorString());
+                      return;
+                    }
+
+                    // Backed off so a struggling endpoint is not hit
+                    // again at once; other parts keep going meanwhile
+                    QTimer::singleShot(
+                        RetryPolicy::backoff(part.attempts,
+                                             RetryPolicy::defaultBaseDelay,
+                                             RetryPolicy::defaultMaxDelay),
+                        this, [this, partIndex]() {
+                          if (m_aborted)
+                            return;
+
+                          m_pendingParts.prepend(partIndex);
+                          dispatchParts();
+                        });
+                    return;
+                  }
+
+                  part.bytesSent = part.size;
+                  part.eTag = partResp->rawHeader("ETag");
+                  emit this->partUploaded(partIndex + 1, part.eTag,
+                                          partBytesUploaded());
+
+                  if (++m_completedParts == m_parts.size()) {
+                    complete();
+                    return;
+                  }
+
+                  dispatchParts();
+                });
+        connect(partResp, &QNetworkReply::finished, partResp,
+                &QNetworkReply::deleteLater);
+      });
+  partHashWatcher->setFuture(FileDigest::sha256(
+      m_fileName, m_parts[partIndex].offset, m_parts[partIndex].size));
+}
+} // namespace eXVHP::Service
@@ -0,0 +1,184 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ShardedMediaService.hxx"
+
+namespace eXVHP::Service {
+// Every shard's service is built on its worker thread, so the network
+// manager, timers and helpers it creates all live there
+ShardedMediaService::ShardedMediaService(int shardCount, QObject *parent)
+    : QObject(parent), m_dispatchPolicy(DispatchPolicy::LeastLoaded) {
+  for (int i = 0; i < qMax(1, shardCount); i++) {
+    Shard *shard = new Shard();
+    shard->service = nullptr;
+    shard->thread = new QThread(this);
+    shard->thread->setObjectName("eXVHP shard " + QString::number(i));
+    shard->context = new QObject();
+    shard->context->moveToThread(shard->thread);
+    connect(shard->thread, &QThread::finished, shard->context,
+            &QObject::deleteLater);
+    shard->thread->start();
+
+    QMetaObject::invokeMethod(
+        shard->context,
+        [this, shard]() {
+          shard->service = new MediaService();
+          connect(shard->thread, &QThread::finished, shard->service,
+                  &QObject::deleteLater);
+          forward(shard);
+        },
+        Qt::BlockingQueuedConnection);
+
+    m_shards.append(shard);
+  }
+
+  connect(this, &ShardedMediaService::mediaUploaded, this,
+          [this](QFile *videoFile) { m_callerShards.remove(videoFile); });
+  connect(this, &ShardedMediaService::mediaUploadError, this,
+          [this](QFile *videoFile) { m_callerShards.remove(videoFile); });
+}
+
+ShardedMediaService::~ShardedMediaService() {
+  for (auto &&shard : m_shards) {
+    shard->thread->quit();
+    shard->thread->wait();
+    delete shard;
+  }
+}
+
+void ShardedMediaService::cancel(QFile *videoFile) {
+  if (!m_callerShards.contains(videoFile))
+    return;
+
+  Shard *shard = m_shards.at(m_callerShards.value(videoFile));
+  QMetaObject::invokeMethod(shard->context, [shard, videoFile]() {
+    QPointer<QFile> shardFile = shard->shardFiles.value(videoFile);
+
+    if (!shardFile.isNull())
+      shard->service->cancel(shardFile);
+  });
+}
+
+// Runs on each shard's worker thread, queued behind the uploads already sent
+// to it. Journals and upload caches are files of their own, so each shard
+// needs a separate path for them.
+void ShardedMediaService::configure(
+    const std::function<void(MediaService *)> &configure) {
+  for (auto &&shard : m_shards)
+    QMetaObject::invokeMethod(
+        shard->context, [configure, shard]() { configure(shard->service); });
+}
+
+// Called on the worker thread; the shard's results are re-emitted with the
+// caller's QFile straight from there
+void ShardedMediaService::forward(Shard *shard) {
+  MediaService *service = shard->service;
+  connect(service, &MediaService::mediaUploaded, service,
+          [this, shard](QFile *shardFile, const QString &videoId,
+                        const QString &videoLink) {
+            QFile *videoFile = shard->callerFiles.value(shardFile);
+
+            if (videoFile == nullptr)
+              return;
+
+            shardFinished(shard, shardFile);
+            emit this->mediaUploaded(videoFile, videoId, videoLink);
+          });
+  connect(service, &MediaService::mediaUploadError, service,
+          [this, shard](QFile *shardFile, const QString &error) {
+            QFile *videoFile = shard->callerFiles.value(shardFile);
+
+            if (videoFile == nullptr)
+              return;
+
+            shardFinished(shard, shardFile);
+            emit this->mediaUploadError(videoFile, error);
+          });
+  connect(service, &MediaService::mediaUploadProgress, service,
+          [this, shard](QFile *shardFile, qint64 bytesSent,
+                        qint64 bytesTotal) {
+            if (QFile *videoFile = shard->callerFiles.value(shardFile))
+              emit this->mediaUploadProgress(videoFile, bytesSent,
+                                             bytesTotal);
+          });
+  connect(service, &MediaService::uploadSpan, service,
+          [this, shard](QFile *shardFile, const UploadSpan &span) {
+            if (QFile *videoFile = shard->callerFiles.value(shardFile))
+              emit this->uploadSpan(videoFile, span);
+          });
+}
+
+int ShardedMediaService::load(int shard) const {
+  return m_shards.at(shard)->load.loadRelaxed();
+}
+
+int ShardedMediaService::pickShard(MediaHost host) const {
+  if (m_dispatchPolicy == DispatchPolicy::HostAffinity)
+    return static_cast<int>(host) % m_shards.size();
+
+  int leastLoaded = 0;
+
+  for (int i = 1; i < m_shards.size(); i++)
+    if (m_shards.at(i)->load.loadRelaxed() <
+        m_shards.at(leastLoaded)->load.loadRelaxed())
+      leastLoaded = i;
+
+  return leastLoaded;
+}
+
+void ShardedMediaService::setDispatchPolicy(DispatchPolicy dispatchPolicy) {
+  m_dispatchPolicy = dispatchPolicy;
+}
+
+int ShardedMediaService::shardCount() const { return m_shards.size(); }
+
+// The upload paths reparent and delete the handle they are given; one that
+// is still around when the upload reports its result is deleted here
+void ShardedMediaService::shardFinished(Shard *shard, QFile *shardFile) {
+  QFile *videoFile = shard->callerFiles.take(shardFile);
+  QPointer<QFile> ownedFile = shard->shardFiles.take(videoFile);
+
+  if (!ownedFile.isNull())
+    ownedFile->deleteLater();
+
+  shard->load.fetchAndSubRelaxed(1);
+}
+
+void ShardedMediaService::upload(MediaHost host, QFile *videoFile,
+                                 const QString &videoTitle,
+                                 const QString &awsRegion) {
+  if (m_callerShards.contains(videoFile)) {
+    emit this->mediaUploadError(videoFile, "File is already being uploaded!");
+    return;
+  }
+
+  int shardIndex = pickShard(host);
+  Shard *shard = m_shards.at(shardIndex);
+  shard->load.fetchAndAddRelaxed(1);
+  m_callerShards.insert(videoFile, shardIndex);
+
+  QString fileName = videoFile->fileName();
+  QMetaObject::invokeMethod(
+      shard->context,
+      [awsRegion, fileName, host, shard, videoFile, videoTitle]() {
+        QFile *shardFile = new QFile(fileName);
+        shard->callerFiles.insert(shardFile, videoFile);
+        shard->shardFiles.insert(videoFile, shardFile);
+        shard->service->upload(host, shardFile, videoTitle, awsRegion);
+      });
+}
+} // namespace eXVHP::Service
@@ -0,0 +1,86 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "SharedFileDevice.hxx"
+#include <cstring>
+
+namespace eXVHP::Service {
+SharedFileDevice::SharedFileDevice(QSharedPointer<SharedFileReader> reader,
+                                   const QObject *consumer, QObject *parent)
+    : ReadOnlyDevice(parent), m_chunkIndex(-1), m_consumer(consumer),
+      m_reader(reader) {}
+
+void SharedFileDevice::close() {
+  QIODevice::close();
+  m_chunk.clear();
+  m_chunkIndex = -1;
+}
+
+bool SharedFileDevice::openSource() {
+  if (!m_reader->open()) {
+    setErrorString(m_reader->errorString());
+    return false;
+  }
+
+  return true;
+}
+
+qint64 SharedFileDevice::readData(char *data, qint64 maxSize) {
+  qint64 readPos = pos();
+  qint64 bytesRead = 0;
+
+  while (bytesRead < maxSize && readPos < size()) {
+    qint64 chunkIndex = readPos / m_reader->chunkSize();
+
+    // Holding on to the current chunk keeps it alive for this device even
+    // after the reader drops it
+    if (chunkIndex != m_chunkIndex) {
+      m_chunk = m_reader->chunk(chunkIndex);
+      m_chunkIndex = chunkIndex;
+
+      if (m_chunk.isEmpty()) {
+        m_chunkIndex = -1;
+        setErrorString("Failed to read shared file chunk!");
+        return bytesRead > 0 ? bytesRead : -1;
+      }
+    }
+
+    qint64 chunkOffset = readPos - chunkIndex * m_reader->chunkSize();
+    qint64 copySize = qMin(maxSize - bytesRead, m_chunk.size() - chunkOffset);
+
+    if (copySize <= 0)
+      break;
+
+    std::memcpy(data + bytesRead, m_chunk.constData() + chunkOffset, copySize);
+    bytesRead += copySize;
+    readPos += copySize;
+  }
+
+  m_reader->setConsumerPos(m_consumer, readPos);
+  return bytesRead;
+}
+
+bool SharedFileDevice::seek(qint64 pos) {
+  if (pos < 0 || pos > size() || !QIODevice::seek(pos))
+    return false;
+
+  m_reader->setConsumerPos(m_consumer, pos);
+  return true;
+}
+
+qint64 SharedFileDevice::size() const { return m_reader->size(); }
+} // namespace eXVHP::Service
@@ -0,0 +1,105 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "SharedFileReader.hxx"
+
+namespace eXVHP::Service {
+qint64 SharedFileReader::defaultChunkSize = 0x100000;
+int SharedFileReader::defaultMaxChunks = 16;
+
+SharedFileReader::SharedFileReader(const QString &fileName, qint64 chunkSize,
+                                   int maxChunks)
+    : m_chunkSize(qMax(qint64(1), chunkSize)), m_file(fileName),
+      m_maxChunks(qMax(1, maxChunks)), m_windowStart(0) {}
+
+void SharedFileReader::addConsumer(const QObject *consumer) {
+  m_consumers.insert(consumer, 0);
+  evict();
+}
+
+QByteArray SharedFileReader::chunk(qint64 index) {
+  auto cached = m_chunks.constFind(index);
+
+  if (cached != m_chunks.constEnd())
+    return cached.value();
+
+  if (!m_file.seek(index * m_chunkSize))
+    return QByteArray();
+
+  QByteArray data = m_file.read(m_chunkSize);
+
+  if (index >= m_windowStart && index < m_windowStart + m_maxChunks)
+    m_chunks.insert(index, data);
+
+  return data;
+}
+
+qint64 SharedFileReader::chunkSize() const { return m_chunkSize; }
+
+QString SharedFileReader::errorString() const { return m_file.errorString(); }
+
+void SharedFileReader::evict() {
+  qint64 windowPos = m_windowStart * m_chunkSize;
+  qint64 slowestPos = -1;
+
+  // Consumers behind the window only count once they catch up to it, unless
+  // none is inside it
+  for (auto &&pos : m_consumers)
+    if (pos >= windowPos && (slowestPos < 0 || pos < slowestPos))
+      slowestPos = pos;
+
+  if (slowestPos < 0)
+    for (auto &&pos : m_consumers)
+      if (slowestPos < 0 || pos < slowestPos)
+        slowestPos = pos;
+
+  m_windowStart = qMax(qint64(0), slowestPos) / m_chunkSize;
+
+  for (auto it = m_chunks.begin(); it != m_chunks.end();) {
+    if (it.key() < m_windowStart || it.key() >= m_windowStart + m_maxChunks)
+      it = m_chunks.erase(it);
+
+    else
+      ++it;
+  }
+}
+
+bool SharedFileReader::open() {
+  return m_file.isOpen() || m_file.open(QIODevice::ReadOnly);
+}
+
+void SharedFileReader::removeConsumer(const QObject *consumer) {
+  m_consumers.remove(consumer);
+  evict();
+}
+
+void SharedFileReader::setConsumerPos(const QObject *consumer, qint64 pos) {
+  auto consumerPos = m_consumers.find(consumer);
+
+  if (consumerPos == m_consumers.end())
+    return;
+
+  // The window only moves when a consumer crosses into another chunk
+  bool movedChunk = pos / m_chunkSize != consumerPos.value() / m_chunkSize;
+  consumerPos.value() = pos;
+
+  if (movedChunk)
+    evict();
+}
+
+qint64 SharedFileReader::size() const { return m_file.size(); }
+} // namespace eXVHP::Service
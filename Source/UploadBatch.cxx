@@ -0,0 +1,185 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "UploadBatch.hxx"
+#include "Service.hxx"
+#include "UploadTokenPool.hxx"
+
+namespace eXVHP::Service {
+UploadBatch::UploadBatch(MediaService *service, MediaHost host,
+                         const QList<QFile *> &videoFiles,
+                         const Options &options, QObject *parent)
+    : QObject(parent), m_bytesTotal(0), m_bytesUploaded(0),
+      m_dispatching(false), m_failed(0), m_finished(false), m_host(host),
+      m_options(options), m_reservedTokens(0), m_service(service),
+      m_succeeded(0), m_tokenPool(service->m_tokenPool) {
+  m_options.maxRunning = qMax(1, m_options.maxRunning);
+  m_options.prefetch = qMax(0, m_options.prefetch);
+
+  // Sizes are taken now since the service deletes each file once sent
+  for (auto &&videoFile : videoFiles) {
+    if (m_fileSizes.contains(videoFile))
+      continue;
+
+    m_fileSizes.insert(videoFile, videoFile->size());
+    m_bytesTotal += videoFile->size();
+    m_pendingFiles.append(videoFile);
+  }
+
+  connect(m_service, &MediaService::mediaUploaded, this,
+          [this](QFile *videoFile, const QString &videoId,
+                 const QString &videoLink) {
+            if (!m_runningBytes.contains(videoFile))
+              return;
+
+            emit this->fileUploaded(videoFile, videoId, videoLink);
+            fileFinished(videoFile, true);
+          });
+  connect(m_service, &MediaService::mediaUploadError, this,
+          [this](QFile *videoFile, const QString &error) {
+            if (!m_runningBytes.contains(videoFile))
+              return;
+
+            emit this->fileUploadError(videoFile, error);
+            fileFinished(videoFile, false);
+          });
+  connect(m_service, &MediaService::mediaUploadProgress, this,
+          [this](QFile *videoFile, qint64 bytesSent) {
+            if (!m_runningBytes.contains(videoFile))
+              return;
+
+            m_runningBytes[videoFile] = bytesSent;
+            reportProgress();
+          });
+}
+
+// Identifiers still reserved would otherwise be kept fetched for good. The
+// pool may already be gone when the batch is deleted with its service.
+UploadBatch::~UploadBatch() {
+  if (m_reservedTokens > 0 && !m_tokenPool.isNull())
+    m_tokenPool->reserve(m_host, -m_reservedTokens);
+}
+
+qint64 UploadBatch::bytesUploaded() const { return m_bytesUploaded; }
+
+// Files not started yet are reported as failed right away; running ones
+// report their own abort through the service
+void UploadBatch::cancel() {
+  if (m_pendingFiles.isEmpty() && m_runningBytes.isEmpty())
+    return;
+
+  QList<QFile *> pendingFiles = m_pendingFiles;
+  m_pendingFiles.clear();
+  reserveTokens();
+
+  for (auto &&videoFile : pendingFiles) {
+    m_failed++;
+    emit this->fileUploadError(videoFile, "Upload canceled!");
+  }
+
+  if (m_runningBytes.isEmpty()) {
+    dispatch();
+    return;
+  }
+
+  for (auto &&videoFile : m_runningBytes.keys())
+    m_service->cancel(videoFile);
+}
+
+int UploadBatch::completedCount() const { return m_succeeded + m_failed; }
+
+// A file rejected before any request reports its error from inside
+// upload(), which finishes it and calls back in here; the loop below picks
+// up the freed slot instead
+void UploadBatch::dispatch() {
+  if (m_dispatching || m_finished)
+    return;
+
+  m_dispatching = true;
+
+  while (m_runningBytes.size() < m_options.maxRunning &&
+         !m_pendingFiles.isEmpty()) {
+    QFile *videoFile = m_pendingFiles.takeFirst();
+    m_runningBytes.insert(videoFile, 0);
+    m_service->upload(m_host, videoFile, m_options.videoTitle,
+                      m_options.awsRegion);
+  }
+
+  m_dispatching = false;
+  reserveTokens();
+
+  if (!m_runningBytes.isEmpty() || !m_pendingFiles.isEmpty())
+    return;
+
+  m_finished = true;
+  emit this->finished(m_succeeded, m_failed, m_elapsedTimer.elapsed(),
+                      throughput());
+}
+
+int UploadBatch::fileCount() const { return m_fileSizes.size(); }
+
+void UploadBatch::fileFinished(QFile *videoFile, bool uploaded) {
+  m_runningBytes.remove(videoFile);
+
+  if (uploaded) {
+    m_succeeded++;
+    m_bytesUploaded += m_fileSizes.value(videoFile);
+  }
+
+  else
+    m_failed++;
+
+  reportProgress();
+  dispatch();
+}
+
+void UploadBatch::reportProgress() {
+  qint64 bytesSent = m_bytesUploaded;
+
+  for (auto &&runningBytes : m_runningBytes)
+    bytesSent += runningBytes;
+
+  emit this->batchProgress(completedCount(), fileCount(), bytesSent,
+                           m_bytesTotal);
+}
+
+// Asks the token pool for as many extra identifiers as there are files
+// left to start, up to the prefetch depth, and gives back the rest
+void UploadBatch::reserveTokens() {
+  int wantedTokens =
+      int(qMin(qsizetype(m_options.prefetch), m_pendingFiles.size()));
+
+  if (wantedTokens == m_reservedTokens)
+    return;
+
+  m_tokenPool->reserve(m_host, wantedTokens - m_reservedTokens);
+  m_reservedTokens = wantedTokens;
+}
+
+// Reserving before the first bodies start lets the identifiers for the
+// files behind them be fetched alongside the first token requests
+void UploadBatch::start() {
+  m_elapsedTimer.start();
+  reserveTokens();
+  dispatch();
+}
+
+double UploadBatch::throughput() const {
+  qint64 elapsed = m_elapsedTimer.isValid() ? m_elapsedTimer.elapsed() : 0;
+  return elapsed > 0 ? m_bytesUploaded * 1000.0 / elapsed : 0;
+}
+} // namespace eXVHP::Service
@@ -0,0 +1,137 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "UploadCache.hxx"
+#include <QDateTime>
+#include <QFile>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <algorithm>
+
+namespace eXVHP::Service {
+int UploadCache::defaultMaxAge = 7 * 24 * 3600;
+int UploadCache::defaultMaxEntries = 10000;
+
+UploadCache::UploadCache()
+    : m_maxAge(defaultMaxAge), m_maxEntries(defaultMaxEntries) {}
+
+void UploadCache::close() {
+  m_entries = QJsonObject();
+  m_path.clear();
+}
+
+QJsonObject UploadCache::entry(const QString &entryKey) const {
+  QJsonObject cacheEntry = m_entries[entryKey].toObject();
+
+  if (QDateTime::currentSecsSinceEpoch() -
+          cacheEntry["uploaded"].toInteger() >
+      m_maxAge)
+    return QJsonObject();
+
+  return cacheEntry;
+}
+
+QString UploadCache::entryKey(MediaHost host, const QByteArray &digest) {
+  return QString::number(static_cast<int>(host)) + "|" + digest.toHex();
+}
+
+void UploadCache::insert(const QString &entryKey, const QString &videoId,
+                         const QString &videoLink) {
+  if (m_path.isEmpty())
+    return;
+
+  m_entries.insert(
+      entryKey, QJsonObject{{"videoId", videoId},
+                            {"videoLink", videoLink},
+                            {"uploaded", QDateTime::currentSecsSinceEpoch()}});
+  prune();
+  save();
+}
+
+bool UploadCache::isOpen() const { return !m_path.isEmpty(); }
+
+bool UploadCache::open(const QString &path, int maxAge, int maxEntries) {
+  m_path = path;
+  m_maxAge = maxAge;
+  m_maxEntries = qMax(1, maxEntries);
+  m_entries = QJsonObject();
+
+  QFile cacheFile(path);
+
+  if (!cacheFile.exists())
+    return true;
+
+  if (!cacheFile.open(QIODevice::ReadOnly)) {
+    m_path.clear();
+    return false;
+  }
+
+  m_entries = QJsonDocument::fromJson(cacheFile.readAll()).object();
+  prune();
+  save();
+  return true;
+}
+
+// Drops expired entries, then the oldest ones while over maxEntries
+void UploadCache::prune() {
+  qint64 now = QDateTime::currentSecsSinceEpoch();
+  QList<QPair<qint64, QString>> uploadTimes;
+
+  for (auto it = m_entries.begin(); it != m_entries.end();) {
+    qint64 uploaded = it.value().toObject()["uploaded"].toInteger();
+
+    if (now - uploaded > m_maxAge) {
+      it = m_entries.erase(it);
+      continue;
+    }
+
+    uploadTimes.append(qMakePair(uploaded, it.key()));
+    ++it;
+  }
+
+  if (uploadTimes.size() <= m_maxEntries)
+    return;
+
+  std::sort(uploadTimes.begin(), uploadTimes.end());
+
+  for (int entryIndex = 0; entryIndex < uploadTimes.size() - m_maxEntries;
+       entryIndex++)
+    m_entries.remove(uploadTimes[entryIndex].second);
+}
+
+void UploadCache::remove(const QString &entryKey) {
+  if (!m_entries.contains(entryKey))
+    return;
+
+  m_entries.remove(entryKey);
+  save();
+}
+
+// Written through QSaveFile so a crash mid-write keeps the previous cache
+void UploadCache::save() const {
+  if (m_path.isEmpty())
+    return;
+
+  QSaveFile cacheFile(m_path);
+
+  if (!cacheFile.open(QIODevice::WriteOnly))
+    return;
+
+  cacheFile.write(QJsonDocument(m_entries).toJson(QJsonDocument::Compact));
+  cacheFile.commit();
+}
+} // namespace eXVHP::Service
@@ -0,0 +1,52 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "UploadJob.hxx"
+
+namespace eXVHP::Service {
+int UploadJobPool::defaultMaxIdle = 64;
+
+AwsSigV4 UploadJob::signer() const {
+  return AwsSigV4(accessKeyId, secretAccessKey, awsRegion);
+}
+
+UploadJobPool::UploadJobPool(int maxIdle) : m_maxIdle(maxIdle), m_nextId(1) {}
+
+UploadJobPool::~UploadJobPool() { qDeleteAll(m_idleJobs); }
+
+UploadJob *UploadJobPool::acquire() {
+  UploadJob *job =
+      m_idleJobs.isEmpty() ? new UploadJob() : m_idleJobs.takeLast();
+  job->id = m_nextId++;
+  job->status = UploadJob::Status::Running;
+  return job;
+}
+
+int UploadJobPool::idleCount() const { return m_idleJobs.size(); }
+
+// The job is cleared right away so a pooled job does not hold on to the
+// file, tokens or payload hash of the upload it last ran
+void UploadJobPool::release(UploadJob *job) {
+  if (m_idleJobs.size() >= m_maxIdle) {
+    delete job;
+    return;
+  }
+
+  *job = UploadJob();
+  m_idleJobs.append(job);
+}
+} // namespace eXVHP::Service
@@ -0,0 +1,123 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "UploadJournal.hxx"
+#include <QDateTime>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QSaveFile>
+
+namespace eXVHP::Service {
+int UploadJournal::defaultMaxAge = 6 * 3600;
+int UploadJournal::maxResumeAttempts = 3;
+
+UploadJournal::UploadJournal() : m_maxAge(defaultMaxAge) {}
+
+void UploadJournal::close() {
+  m_jobs = QJsonObject();
+  m_path.clear();
+}
+
+bool UploadJournal::isOpen() const { return !m_path.isEmpty(); }
+
+QJsonObject UploadJournal::job(const QString &jobKey) const {
+  return m_jobs[jobKey].toObject();
+}
+
+QString UploadJournal::jobKey(MediaHost host, const QString &fileName) {
+  QFileInfo fileInfo(fileName);
+  return QString::number(static_cast<int>(host)) + "|" +
+         fileInfo.absoluteFilePath() + "|" +
+         QString::number(fileInfo.size()) + "|" +
+         QString::number(fileInfo.lastModified().toMSecsSinceEpoch());
+}
+
+QStringList UploadJournal::jobKeys() const { return m_jobs.keys(); }
+
+bool UploadJournal::open(const QString &path, int maxAge) {
+  m_path = path;
+  m_maxAge = maxAge;
+  m_jobs = QJsonObject();
+
+  QFile journalFile(path);
+
+  if (!journalFile.exists())
+    return true;
+
+  if (!journalFile.open(QIODevice::ReadOnly)) {
+    m_path.clear();
+    return false;
+  }
+
+  QJsonObject jobs = QJsonDocument::fromJson(journalFile.readAll()).object();
+  qint64 now = QDateTime::currentSecsSinceEpoch();
+
+  // Drop jobs that went stale or whose file has changed since
+  for (auto it = jobs.constBegin(); it != jobs.constEnd(); ++it) {
+    QJsonObject job = it.value().toObject();
+    MediaHost host = static_cast<MediaHost>(job["host"].toInt());
+
+    if (now - job["updated"].toInteger() > m_maxAge ||
+        jobKey(host, job["fileName"].toString()) != it.key())
+      continue;
+
+    m_jobs.insert(it.key(), job);
+  }
+
+  save();
+  return true;
+}
+
+void UploadJournal::removeJob(const QString &jobKey) {
+  if (!m_jobs.contains(jobKey))
+    return;
+
+  m_jobs.remove(jobKey);
+  save();
+}
+
+// Written through QSaveFile so a crash mid-write keeps the previous journal
+void UploadJournal::save() const {
+  if (m_path.isEmpty())
+    return;
+
+  QSaveFile journalFile(m_path);
+
+  if (!journalFile.open(QIODevice::WriteOnly))
+    return;
+
+  journalFile.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+
+  journalFile.write(QJsonDocument(m_jobs).toJson(QJsonDocument::Compact));
+  journalFile.commit();
+}
+
+void UploadJournal::updateJob(const QString &jobKey,
+                              const QJsonObject &fields) {
+  if (m_path.isEmpty())
+    return;
+
+  QJsonObject job = m_jobs.value(jobKey).toObject();
+
+  for (auto it = fields.constBegin(); it != fields.constEnd(); ++it)
+    job.insert(it.key(), it.value());
+
+  job["updated"] = QDateTime::currentSecsSinceEpoch();
+  m_jobs.insert(jobKey, job);
+  save();
+}
+} // namespace eXVHP::Service
@@ -0,0 +1,209 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "UploadMetrics.hxx"
+#include <algorithm>
+
+namespace eXVHP::Service {
+// Upper bounds in seconds; the last bucket is +Inf
+QList<double> UploadMetrics::bucketBounds = {
+    0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1,
+    2.5,   5,    10,    30,   60,  120,  300, 600};
+
+QString UploadMetrics::hostLabel(MediaHost host) {
+  switch (host) {
+  case MediaHost::Dubz:
+    return "dubz";
+
+  case MediaHost::Imgur:
+    return "imgur";
+
+  case MediaHost::JustStreamLive:
+    return "juststreamlive";
+
+  case MediaHost::Streamable:
+    return "streamable";
+
+  case MediaHost::Streamff:
+    return "streamff";
+
+  case MediaHost::Streamja:
+    return "streamja";
+
+  default:
+    return "unknown";
+  }
+}
+
+double UploadMetrics::percentile(MediaHost host, UploadPhase phase,
+                                 double q) const {
+  auto histogram = m_histograms.constFind({host, phase});
+
+  if (histogram == m_histograms.constEnd())
+    return 0;
+
+  return quantile(histogram.value(), q);
+}
+
+QString UploadMetrics::phaseLabel(UploadPhase phase) {
+  switch (phase) {
+  case UploadPhase::Token:
+    return "token";
+
+  case UploadPhase::Metadata:
+    return "metadata";
+
+  case UploadPhase::Hash:
+    return "hash";
+
+  case UploadPhase::Body:
+    return "body";
+
+  case UploadPhase::Transcode:
+    return "transcode";
+
+  case UploadPhase::Poll:
+    return "poll";
+
+  default:
+    return "unknown";
+  }
+}
+
+QString UploadMetrics::prometheusText() const {
+  QString text;
+  text += "# HELP exvhp_upload_phase_duration_seconds Time spent in each "
+          "upload phase.\n"
+          "# TYPE exvhp_upload_phase_duration_seconds histogram\n";
+
+  for (auto it = m_histograms.cbegin(); it != m_histograms.cend(); ++it) {
+    QString labels = "host=\"" + hostLabel(it.key().first) + "\",phase=\"" +
+                     phaseLabel(it.key().second) + "\"";
+    const Histogram &histogram = it.value();
+    quint64 cumulativeCount = 0;
+
+    for (int bucket = 0; bucket < bucketBounds.size(); bucket++) {
+      cumulativeCount += histogram.bucketCounts[bucket];
+      text += "exvhp_upload_phase_duration_seconds_bucket{" + labels +
+              ",le=\"" + QString::number(bucketBounds[bucket]) + "\"} " +
+              QString::number(cumulativeCount) + "\n";
+    }
+
+    text += "exvhp_upload_phase_duration_seconds_bucket{" + labels +
+            ",le=\"+Inf\"} " + QString::number(histogram.count) + "\n";
+    text += "exvhp_upload_phase_duration_seconds_sum{" + labels + "} " +
+            QString::number(histogram.durationSum) + "\n";
+    text += "exvhp_upload_phase_duration_seconds_count{" + labels + "} " +
+            QString::number(histogram.count) + "\n";
+  }
+
+  text += "# HELP exvhp_upload_phase_duration_quantile_seconds Estimated "
+          "phase duration quantiles.\n"
+          "# TYPE exvhp_upload_phase_duration_quantile_seconds gauge\n";
+
+  for (auto it = m_histograms.cbegin(); it != m_histograms.cend(); ++it) {
+    QString labels = "host=\"" + hostLabel(it.key().first) + "\",phase=\"" +
+                     phaseLabel(it.key().second) + "\"";
+
+    for (double q : {0.5, 0.95, 0.99})
+      text += "exvhp_upload_phase_duration_quantile_seconds{" + labels +
+              ",quantile=\"" + QString::number(q) + "\"} " +
+              QString::number(quantile(it.value(), q)) + "\n";
+  }
+
+  text += "# HELP exvhp_upload_phase_errors_total Upload phases that "
+          "failed.\n"
+          "# TYPE exvhp_upload_phase_errors_total counter\n";
+
+  for (auto it = m_histograms.cbegin(); it != m_histograms.cend(); ++it)
+    text += "exvhp_upload_phase_errors_total{host=\"" +
+            hostLabel(it.key().first) + "\",phase=\"" +
+            phaseLabel(it.key().second) + "\"} " +
+            QString::number(it.value().errors) + "\n";
+
+  text += "# HELP exvhp_upload_phase_retries_total Upload phase attempts that "
+          "were retries.\n"
+          "# TYPE exvhp_upload_phase_retries_total counter\n";
+
+  for (auto it = m_histograms.cbegin(); it != m_histograms.cend(); ++it)
+    text += "exvhp_upload_phase_retries_total{host=\"" +
+            hostLabel(it.key().first) + "\",phase=\"" +
+            phaseLabel(it.key().second) + "\"} " +
+            QString::number(it.value().retries) + "\n";
+
+  text += "# HELP exvhp_upload_phase_sent_bytes_total Bytes sent by upload "
+          "phases.\n"
+          "# TYPE exvhp_upload_phase_sent_bytes_total counter\n";
+
+  for (auto it = m_histograms.cbegin(); it != m_histograms.cend(); ++it)
+    text += "exvhp_upload_phase_sent_bytes_total{host=\"" +
+            hostLabel(it.key().first) + "\",phase=\"" +
+            phaseLabel(it.key().second) + "\"} " +
+            QString::number(it.value().bytesSent) + "\n";
+
+  return text;
+}
+
+// Linear interpolation inside the bucket holding the q-th observation, the
+// same estimate Prometheus' histogram_quantile() makes
+double UploadMetrics::quantile(const Histogram &histogram, double q) {
+  if (histogram.count == 0)
+    return 0;
+
+  double rank = q * histogram.count;
+  quint64 cumulativeCount = 0;
+
+  for (int bucket = 0; bucket < bucketBounds.size(); bucket++) {
+    quint64 bucketCount = histogram.bucketCounts[bucket];
+
+    if (cumulativeCount + bucketCount >= rank && bucketCount > 0) {
+      double lowerBound = bucket == 0 ? 0 : bucketBounds[bucket - 1];
+      return lowerBound + (bucketBounds[bucket] - lowerBound) *
+                              (rank - cumulativeCount) / bucketCount;
+    }
+
+    cumulativeCount += bucketCount;
+  }
+
+  // Past the last finite bound there is nothing to interpolate against
+  return bucketBounds.last();
+}
+
+void UploadMetrics::record(const UploadSpan &span) {
+  Histogram &histogram = m_histograms[{span.host, span.phase}];
+
+  if (histogram.bucketCounts.isEmpty())
+    histogram.bucketCounts.fill(0, bucketBounds.size() + 1);
+
+  double duration = (span.endTime - span.startTime) / 1000.0;
+  int bucket =
+      std::lower_bound(bucketBounds.cbegin(), bucketBounds.cend(), duration) -
+      bucketBounds.cbegin();
+  histogram.bucketCounts[bucket]++;
+  histogram.count++;
+  histogram.durationSum += duration;
+  // Every attempt after the first reports its own span, so each retried
+  // span counts once
+  histogram.retries += span.retries > 0 ? 1 : 0;
+  histogram.bytesSent += span.bytesSent;
+
+  if (!span.error.isEmpty())
+    histogram.errors++;
+}
+
+void UploadMetrics::reset() { m_histograms.clear(); }
+} // namespace eXVHP::Service
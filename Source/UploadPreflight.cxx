@@ -0,0 +1,273 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "UploadPreflight.hxx"
+#include <QFile>
+#include <QtConcurrent>
+#include <QtEndian>
+
+namespace eXVHP::Service {
+QMap<MediaHost, UploadPreflight::HostCapability>
+    UploadPreflight::capabilities = {
+        {MediaHost::Dubz,
+         {{ContainerFormat::Mp4},
+          -1,
+          "Unsupported file type! Dubz only supports MP4!",
+          QString()}},
+        {MediaHost::Imgur,
+         {{ContainerFormat::Matroska, ContainerFormat::Mp4,
+           ContainerFormat::QuickTime},
+          50 * 0x100000,
+          "Unsupported file type! Imgur accepts MKV/MOV/MP4!",
+          "File too big! Imgur supports 200MB maximum!"}},
+        {MediaHost::JustStreamLive,
+         {{ContainerFormat::Matroska, ContainerFormat::Mp4,
+           ContainerFormat::WebM},
+          200 * 0x100000,
+          "Unsupported file type! JustStreamLive accepts MKV/MP4/WEBM!",
+          "File too big! JustStreamLive supports 200MB maximum!"}},
+        {MediaHost::Streamable,
+         {{ContainerFormat::Matroska, ContainerFormat::Mp4,
+           ContainerFormat::QuickTime},
+          250 * 0x100000,
+          "Unsupported file type! Streamable only accepts MKV/MOV/MP4!",
+          "File too big! Streamable supports 250MB maximum!"}},
+        {MediaHost::Streamff,
+         {{ContainerFormat::Mp4},
+          200 * 0x100000,
+          "Unsupported file type! Streamff accepts MP4 only!",
+          "File too big! Streamff supports 200MB maximum!"}},
+        {MediaHost::Streamja,
+         {{ContainerFormat::Mp4},
+          30 * 0x100000,
+          "Unsupported file type! Streamja only accepts MP4!",
+          "File too big! Streamja supports 30MB maximum!"}},
+};
+int UploadPreflight::maxProbeBoxes = 64;
+qint64 UploadPreflight::probeSize = 4 * 0x400;
+
+// Format of a file whose first ftyp or moov box starts boxData
+UploadPreflight::ContainerFormat
+UploadPreflight::boxFormat(const QByteArray &boxData) {
+  if (boxData.mid(4, 4) == "moov")
+    return ContainerFormat::QuickTime;
+
+  qsizetype brandPos = qFromBigEndian<quint32>(boxData.constData()) == 1 ? 16
+                                                                        : 8;
+  return boxData.mid(brandPos, 4) == "qt  " ? ContainerFormat::QuickTime
+                                            : ContainerFormat::Mp4;
+}
+
+UploadPreflight::HostCapability UploadPreflight::capability(MediaHost host) {
+  return capabilities.value(host);
+}
+
+UploadPreflight::Result UploadPreflight::check(MediaHost host,
+                                               const QString &fileName) {
+  HostCapability hostCapability = capabilities.value(host);
+  Result result{fileName, host, probeFile(fileName), QString(), QString()};
+  result.mimeType = mimeType(result.format);
+
+  if (!hostCapability.formats.contains(result.format))
+    result.error = hostCapability.formatError;
+
+  else if (hostCapability.maxSize >= 0 &&
+           QFile(fileName).size() > hostCapability.maxSize)
+    result.error = hostCapability.sizeError;
+
+  return result;
+}
+
+QFuture<UploadPreflight::Result>
+UploadPreflight::checkAll(const QList<QPair<MediaHost, QString>> &uploads,
+                          QThreadPool *pool) {
+  return QtConcurrent::mapped(pool, uploads,
+                              [](const QPair<MediaHost, QString> &upload) {
+                                return check(upload.first, upload.second);
+                              });
+}
+
+// Top-level boxes found in MP4 and QuickTime files
+bool UploadPreflight::isBoxType(const QByteArray &boxType) {
+  static const QList<QByteArray> boxTypes = {
+      "free", "ftyp", "junk", "mdat", "meta", "mfra", "moof", "moov",
+      "pdin", "pnot", "sidx", "skip", "styp", "uuid", "wide"};
+  return boxTypes.contains(boxType);
+}
+
+QString UploadPreflight::mimeType(ContainerFormat format) {
+  switch (format) {
+  case ContainerFormat::Matroska:
+    return "video/x-matroska";
+
+  case ContainerFormat::Mp4:
+    return "video/mp4";
+
+  case ContainerFormat::QuickTime:
+    return "video/quicktime";
+
+  case ContainerFormat::WebM:
+    return "video/webm";
+
+  default:
+    return "application/octet-stream";
+  }
+}
+
+UploadPreflight::ContainerFormat
+UploadPreflight::probe(const QByteArray &header) {
+  // ISO base media or QuickTime file; boxes that run past the header are
+  // followed by probeFile()
+  qsizetype pos = 0;
+  quint64 boxSize;
+  QByteArray boxType;
+
+  while (readBox(header, pos, boxSize, boxType) && isBoxType(boxType)) {
+    if (boxType == "ftyp" || boxType == "moov")
+      return boxFormat(header.mid(pos, 24));
+
+    if (boxSize == 0 || boxSize > quint64(header.size() - pos))
+      break;
+
+    pos += boxSize;
+  }
+
+  if (!header.startsWith("\x1A\x45\xDF\xA3"))
+    return ContainerFormat::Unknown;
+
+  // EBML header element, look for its DocType child
+  pos = 4;
+  quint64 headerSize;
+
+  if (!readVint(header, pos, false, headerSize))
+    return ContainerFormat::Unknown;
+
+  qsizetype headerEnd = qMin(header.size(), qsizetype(pos + headerSize));
+
+  while (pos < headerEnd) {
+    quint64 elementId, elementSize;
+
+    if (!readVint(header, pos, true, elementId) ||
+        !readVint(header, pos, false, elementSize) ||
+        elementSize > quint64(headerEnd - pos))
+      break;
+
+    if (elementId == 0x4282) {
+      QByteArray docType = header.mid(pos, elementSize);
+
+      if (docType.startsWith("matroska"))
+        return ContainerFormat::Matroska;
+
+      if (docType.startsWith("webm"))
+        return ContainerFormat::WebM;
+
+      break;
+    }
+
+    pos += elementSize;
+  }
+
+  return ContainerFormat::Unknown;
+}
+
+UploadPreflight::ContainerFormat
+UploadPreflight::probeFile(const QString &fileName) {
+  QFile file(fileName);
+
+  if (!file.open(QIODevice::ReadOnly))
+    return ContainerFormat::Unknown;
+
+  QByteArray header = file.read(probeSize);
+  ContainerFormat format = probe(header);
+  quint64 boxSize;
+  QByteArray boxType;
+
+  if (format != ContainerFormat::Unknown ||
+      !readBox(header, 0, boxSize, boxType) || !isBoxType(boxType))
+    return format;
+
+  // Files written with their moov box last start with a large mdat box, so
+  // the top-level boxes are walked by seeking over them
+  qint64 pos = 0;
+
+  for (int boxIndex = 0; boxIndex < maxProbeBoxes; boxIndex++) {
+    if (!file.seek(pos))
+      break;
+
+    QByteArray boxData = file.read(24);
+
+    if (!readBox(boxData, 0, boxSize, boxType) || !isBoxType(boxType))
+      break;
+
+    if (boxType == "ftyp" || boxType == "moov")
+      return boxFormat(boxData);
+
+    if (boxSize == 0)
+      break;
+
+    pos += boxSize;
+  }
+
+  return ContainerFormat::Unknown;
+}
+
+// ISO base media box header at pos: a 32-bit big-endian size and the type,
+// with a 64-bit size following when the size is 1. A size of 0 means the box
+// runs to the end of the file.
+bool UploadPreflight::readBox(const QByteArray &data, qsizetype pos,
+                              quint64 &boxSize, QByteArray &boxType) {
+  if (pos < 0 || pos + 8 > data.size())
+    return false;
+
+  boxSize = qFromBigEndian<quint32>(data.constData() + pos);
+  boxType = data.mid(pos + 4, 4);
+
+  if (boxSize == 1) {
+    if (pos + 16 > data.size())
+      return false;
+
+    boxSize = qFromBigEndian<quint64>(data.constData() + pos + 8);
+  }
+
+  return boxSize == 0 || boxSize >= 8;
+}
+
+// EBML variable length integer; the count of leading zero bits in the first
+// byte gives the length. IDs keep the length marker bit, sizes drop it.
+bool UploadPreflight::readVint(const QByteArray &data, qsizetype &pos,
+                               bool keepMarker, quint64 &value) {
+  if (pos >= data.size())
+    return false;
+
+  quint8 firstByte = data[pos];
+  int length = 1;
+
+  while (length <= 8 && !(firstByte & (0x80 >> (length - 1))))
+    length++;
+
+  if (length > 8 || pos + length > data.size())
+    return false;
+
+  value = keepMarker ? firstByte : firstByte & (0xFF >> length);
+
+  for (int byteIndex = 1; byteIndex < length; byteIndex++)
+    value = (value << 8) | quint8(data[pos + byteIndex]);
+
+  pos += length;
+  return true;
+}
+} // namespace eXVHP::Service
@@ -0,0 +1,124 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "UploadProgress.hxx"
+
+namespace eXVHP::Service {
+int UploadProgress::defaultInterval = 100;
+int UploadProgress::sampleInterval = 250;
+
+UploadProgress::UploadProgress() : m_interval(defaultInterval) {
+  m_clock.start();
+}
+
+int UploadProgress::interval() const { return m_interval; }
+
+// Milliseconds until the earliest held back update is due, or -1 if none is
+int UploadProgress::nextDue() const {
+  qint64 now = m_clock.elapsed();
+  qint64 due = -1;
+
+  for (auto &&entry : m_entries) {
+    if (!entry.pending)
+      continue;
+
+    qint64 entryDue = qMax(qint64(0), entry.reportTime + m_interval - now);
+
+    if (due < 0 || entryDue < due)
+      due = entryDue;
+  }
+
+  return int(due);
+}
+
+void UploadProgress::remove(QFile *videoFile) { m_entries.remove(videoFile); }
+
+void UploadProgress::setInterval(int interval) {
+  m_interval = qMax(0, interval);
+}
+
+// Marks the file's latest progress as reported
+ProgressSnapshot UploadProgress::snapshot(QFile *videoFile) {
+  Entry &entry = m_entries[videoFile];
+  entry.pending = false;
+  entry.reportTime = m_clock.elapsed();
+
+  ProgressSnapshot snapshot;
+  snapshot.videoFile = videoFile;
+  snapshot.bytesSent = entry.bytesSent;
+  snapshot.bytesTotal = entry.bytesTotal;
+  snapshot.bytesPerSecond = entry.bytesPerSecond;
+  snapshot.totalBytesPerSecond = throughput();
+  snapshot.timestamp = entry.reportTime;
+  return snapshot;
+}
+
+QList<QFile *> UploadProgress::takeDue() {
+  qint64 now = m_clock.elapsed();
+  QList<QFile *> dueFiles;
+
+  for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it)
+    if (it->pending && now - it->reportTime >= m_interval)
+      dueFiles.append(it.key());
+
+  return dueFiles;
+}
+
+double UploadProgress::throughput() const {
+  double bytesPerSecond = 0;
+
+  for (auto &&entry : m_entries)
+    bytesPerSecond += entry.bytesPerSecond;
+
+  return bytesPerSecond;
+}
+
+// Returns whether the update should be reported right away; otherwise it is
+// held until takeDue() returns the file
+bool UploadProgress::update(QFile *videoFile, qint64 bytesSent,
+                            qint64 bytesTotal) {
+  qint64 now = m_clock.elapsed();
+
+  if (!m_entries.contains(videoFile))
+    m_entries[videoFile].sampleTime = now;
+
+  Entry &entry = m_entries[videoFile];
+
+  // A resent request restarts its byte count, which is not a negative rate
+  if (bytesSent < entry.sampleBytes) {
+    entry.sampleBytes = bytesSent;
+    entry.sampleTime = now;
+  }
+
+  if (now - entry.sampleTime >= sampleInterval) {
+    double sampleRate =
+        (bytesSent - entry.sampleBytes) * 1000.0 / (now - entry.sampleTime);
+    entry.bytesPerSecond = entry.bytesPerSecond == 0
+                               ? sampleRate
+                               : 0.7 * entry.bytesPerSecond + 0.3 * sampleRate;
+    entry.sampleBytes = bytesSent;
+    entry.sampleTime = now;
+  }
+
+  entry.bytesSent = bytesSent;
+  entry.bytesTotal = bytesTotal;
+  entry.pending = true;
+
+  return (bytesTotal > 0 && bytesSent == bytesTotal) ||
+         now - entry.reportTime >= m_interval || entry.reportTime < 0;
+}
+} // namespace eXVHP::Service
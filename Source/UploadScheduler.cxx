@@ -0,0 +1,170 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "UploadScheduler.hxx"
+
+namespace eXVHP::Service {
+int UploadScheduler::defaultHostLimit = 4;
+int UploadScheduler::defaultMaxRunning = 8;
+
+UploadScheduler::UploadScheduler(MediaService *service, QObject *parent)
+    : QObject(parent), m_dispatching(false),
+      m_hostLimits{{MediaHost::Streamja, 2}},
+      m_lastStartedHost(MediaHost::Streamja),
+      m_maxRunning(defaultMaxRunning), m_queueDepth(0), m_service(service) {
+  connect(m_service, &MediaService::mediaUploaded, this,
+          [this](QFile *videoFile) { uploadFinished(videoFile); });
+  connect(m_service, &MediaService::mediaUploadError, this,
+          [this](QFile *videoFile) { uploadFinished(videoFile); });
+}
+
+// A slot connected to a signal emitted here may enqueue or change a limit;
+// the running loop picks that up instead of starting a nested one
+void UploadScheduler::dispatch() {
+  if (m_dispatching)
+    return;
+
+  m_dispatching = true;
+  int runningBefore = m_runningUploads.size();
+  int queueDepthBefore = m_queueDepth;
+
+  while (m_runningUploads.size() < m_maxRunning && m_queueDepth > 0) {
+    // Pick the highest priority head of queue among hosts below their cap,
+    // breaking ties round-robin starting after the last host started
+    QList<MediaHost> hosts = m_hostQueues.keys();
+    qsizetype startIndex = hosts.indexOf(m_lastStartedHost) + 1;
+    bool hostFound = false;
+    MediaHost nextHost = m_lastStartedHost;
+
+    for (qsizetype i = 0; i < hosts.size(); i++) {
+      MediaHost host = hosts[(startIndex + i) % hosts.size()];
+      const QList<QueuedUpload> &hostQueue = m_hostQueues[host];
+
+      if (hostQueue.isEmpty() || m_hostRunning[host] >= hostLimit(host))
+        continue;
+
+      if (!hostFound || hostQueue.first().priority >
+                            m_hostQueues[nextHost].first().priority) {
+        hostFound = true;
+        nextHost = host;
+      }
+    }
+
+    if (!hostFound)
+      break;
+
+    QueuedUpload nextUpload = m_hostQueues[nextHost].takeFirst();
+    m_queuedUploads.remove(nextUpload.videoFile);
+    m_queueDepth--;
+    m_hostRunning[nextHost]++;
+    m_lastStartedHost = nextHost;
+    m_runningUploads.insert(nextUpload.videoFile, nextHost);
+
+    emit this->uploadStarted(nextUpload.videoFile, nextHost,
+                             nextUpload.enqueueTimer.elapsed());
+
+    // Started from the event loop, since an upload that fails its preflight
+    // reports the error synchronously and would finish inside this loop
+    QMetaObject::invokeMethod(
+        m_service,
+        [nextHost, nextUpload, service = m_service]() {
+          service->upload(nextHost, nextUpload.videoFile,
+                          nextUpload.videoTitle, nextUpload.awsRegion);
+        },
+        Qt::QueuedConnection);
+  }
+
+  m_dispatching = false;
+
+  if (m_queueDepth != queueDepthBefore)
+    emit this->queueDepthChanged(m_queueDepth);
+
+  if (m_runningUploads.size() != runningBefore)
+    emit this->runningCountChanged(m_runningUploads.size());
+}
+
+bool UploadScheduler::enqueue(MediaHost host, QFile *videoFile,
+                              const QString &videoTitle,
+                              const QString &awsRegion, int priority) {
+  if (m_queuedUploads.contains(videoFile) ||
+      m_runningUploads.contains(videoFile))
+    return false;
+
+  QueuedUpload queuedUpload{awsRegion, QElapsedTimer(), priority, videoTitle,
+                            videoFile};
+  queuedUpload.enqueueTimer.start();
+
+  QList<QueuedUpload> &hostQueue = m_hostQueues[host];
+  qsizetype insertIndex = hostQueue.size();
+
+  while (insertIndex > 0 && hostQueue[insertIndex - 1].priority < priority)
+    insertIndex--;
+
+  hostQueue.insert(insertIndex, queuedUpload);
+  m_queuedUploads.insert(videoFile, host);
+  m_queueDepth++;
+  emit this->queueDepthChanged(m_queueDepth);
+  dispatch();
+  return true;
+}
+
+int UploadScheduler::hostLimit(MediaHost host) const {
+  return m_hostLimits.value(host, defaultHostLimit);
+}
+
+int UploadScheduler::queueDepth() const { return m_queueDepth; }
+
+bool UploadScheduler::remove(QFile *videoFile) {
+  if (!m_queuedUploads.contains(videoFile))
+    return false;
+
+  QList<QueuedUpload> &hostQueue =
+      m_hostQueues[m_queuedUploads.take(videoFile)];
+
+  for (qsizetype i = 0; i < hostQueue.size(); i++) {
+    if (hostQueue[i].videoFile == videoFile) {
+      hostQueue.removeAt(i);
+      break;
+    }
+  }
+
+  m_queueDepth--;
+  emit this->queueDepthChanged(m_queueDepth);
+  return true;
+}
+
+int UploadScheduler::runningCount() const { return m_runningUploads.size(); }
+
+void UploadScheduler::setHostLimit(MediaHost host, int limit) {
+  m_hostLimits[host] = qMax(1, limit);
+  dispatch();
+}
+
+void UploadScheduler::setMaxRunning(int maxRunning) {
+  m_maxRunning = qMax(1, maxRunning);
+  dispatch();
+}
+
+void UploadScheduler::uploadFinished(QFile *videoFile) {
+  if (!m_runningUploads.contains(videoFile))
+    return;
+
+  m_hostRunning[m_runningUploads.take(videoFile)]--;
+  emit this->runningCountChanged(m_runningUploads.size());
+  dispatch();
+}
+} // namespace eXVHP::Service
@@ -0,0 +1,198 @@
+/*
+ * eXVHP - External video hosting platform communication layer via Qt
+ * Copyright (C) 2021 - eXhumer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "UploadTokenPool.hxx"
+#include "Service.hxx"
+#include <QNetworkReply>
+
+namespace eXVHP::Service {
+int UploadTokenPool::defaultTokenLifetime = 600000;
+int UploadTokenPool::retryDelay = 5000;
+
+UploadTokenPool::UploadTokenPool(MediaService *service)
+    : QObject(service), m_service(service) {
+  m_expiryTimer.setSingleShot(true);
+  connect(&m_expiryTimer, &QTimer::timeout, this, &UploadTokenPool::prune);
+}
+
+int UploadTokenPool::available(MediaHost host) const {
+  return m_pools.value(host).tokens.size();
+}
+
+void UploadTokenPool::fetch(MediaHost host) {
+  QNetworkReply *tokenResp = m_service->requestUploadToken(host);
+
+  if (tokenResp == nullptr)
+    return;
+
+  m_pools[host].fetching++;
+
+  connect(tokenResp, &QNetworkReply::finished, this, [this, host, tokenResp]() {
+    HostPool &pool = m_pools[host];
+    pool.fetching--;
+
+    QString error;
+    QString token = m_service->uploadToken(host, tokenResp);
+
+    if (token.isEmpty())
+      error = tokenResp->error() != QNetworkReply::NoError
+                  ? tokenResp->errorString()
+                  : "Failed to parse upload token from response!";
+
+    else if (pool.tokens.size() < pool.targetSize + pool.reserved) {
+      QDateTime expiry =
+          QDateTime::currentDateTimeUtc().addMSecs(pool.tokenLifetime);
+      pool.tokens.append(Token{token, expiry});
+      scheduleExpiry();
+    }
+
+    if (!error.isEmpty()) {
+      emit this->tokenFetchFailed(host, error);
+      QTimer::singleShot(retryDelay, this, [this, host]() { refill(host); });
+    }
+  });
+  connect(tokenResp, &QNetworkReply::finished, tokenResp,
+          &QNetworkReply::deleteLater);
+}
+
+void UploadTokenPool::preconnect(MediaHost host) {
+  HostPool pool = m_pools.value(host);
+
+  if (pool.targetSize + pool.reserved > 0)
+    warm(host);
+}
+
+void UploadTokenPool::prune() {
+  QDateTime now = QDateTime::currentDateTimeUtc();
+
+  for (auto it = m_pools.begin(); it != m_pools.end(); ++it) {
+    HostPool &pool = it.value();
+
+    while (!pool.tokens.isEmpty() && pool.tokens.first().expiry <= now)
+      pool.tokens.removeFirst();
+
+    if (pool.warmExpiry.isValid() && pool.warmExpiry <= now)
+      warm(it.key());
+
+    refill(it.key());
+  }
+
+  scheduleExpiry();
+}
+
+void UploadTokenPool::refill(MediaHost host) {
+  HostPool &pool = m_pools[host];
+
+  if (host == MediaHost::Streamable) {
+    if (pool.targetSize + pool.reserved > 0 && !pool.warmExpiry.isValid())
+      warm(host);
+
+    return;
+  }
+
+  while (pool.tokens.size() + pool.fetching < pool.targetSize + pool.reserved)
+    fetch(host);
+}
+
+// Raises (or with a negative count lowers) the pool size on top of its
+// target for as long as an upload batch needs identifiers ahead of its
+// bodies. Tokens left over when the reservation drops are kept until taken
+// or expired.
+void UploadTokenPool::reserve(MediaHost host, int count) {
+  HostPool &pool = m_pools[host];
+  pool.reserved = qMax(0, pool.reserved + count);
+
+  if (pool.tokenLifetime == 0)
+    pool.tokenLifetime = defaultTokenLifetime;
+
+  if (pool.targetSize + pool.reserved == 0)
+    pool.warmExpiry = QDateTime();
+
+  refill(host);
+  scheduleExpiry();
+}
+
+void UploadTokenPool::scheduleExpiry() {
+  QDateTime nextExpiry;
+
+  // Tokens are appended in fetch order with one lifetime per host, so the
+  // head of each list expires first
+  for (auto &&pool : m_pools) {
+    if (!pool.tokens.isEmpty() &&
+        (!nextExpiry.isValid() || pool.tokens.first().expiry < nextExpiry))
+      nextExpiry = pool.tokens.first().expiry;
+
+    if (pool.warmExpiry.isValid() &&
+        (!nextExpiry.isValid() || pool.warmExpiry < nextExpiry))
+      nextExpiry = pool.warmExpiry;
+  }
+
+  if (!nextExpiry.isValid()) {
+    m_expiryTimer.stop();
+    return;
+  }
+
+  m_expiryTimer.start(
+      qMax(qint64(0), QDateTime::currentDateTimeUtc().msecsTo(nextExpiry)));
+}
+
+void UploadTokenPool::setTarget(MediaHost host, int targetSize,
+                                int tokenLifetime) {
+  HostPool &pool = m_pools[host];
+  pool.targetSize = qMax(0, targetSize);
+  pool.tokenLifetime = qMax(1000, tokenLifetime);
+
+  while (pool.tokens.size() > pool.targetSize + pool.reserved)
+    pool.tokens.removeLast();
+
+  if (pool.targetSize + pool.reserved == 0)
+    pool.warmExpiry = QDateTime();
+
+  refill(host);
+  scheduleExpiry();
+}
+
+QString UploadTokenPool::take(MediaHost host) {
+  if (!m_pools.contains(host))
+    return QString();
+
+  HostPool &pool = m_pools[host];
+  QDateTime now = QDateTime::currentDateTimeUtc();
+  QString token;
+
+  while (!pool.tokens.isEmpty() && token.isEmpty()) {
+    Token head = pool.tokens.takeFirst();
+
+    if (head.expiry > now)
+      token = head.value;
+  }
+
+  refill(host);
+  scheduleExpiry();
+  return token;
+}
+
+void UploadTokenPool::warm(MediaHost host) {
+  HostPool &pool = m_pools[host];
+
+  m_service->warmUp({host});
+
+  pool.warmExpiry =
+      QDateTime::currentDateTimeUtc().addMSecs(pool.tokenLifetime);
+  scheduleExpiry();
+}
+} // namespace eXVHP::Service